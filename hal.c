@@ -6,12 +6,33 @@
 
 #define TAG_HAL "TamaLIB"
 
+typedef struct {
+    uint8_t ratio; // tamalib_set_speed() argument, 0 runs unthrottled
+    uint8_t slowdown; // TamaClock divider below 1x
+    uint8_t frame_skip; // Only every Nth GUI frame is drawn
+    bool audible;
+} TamaSpeedConfig;
+
+static const TamaSpeedConfig speed_configs[TamaSpeedNum] = {
+    [TamaSpeedQuarter] = {.ratio = 1, .slowdown = 4, .frame_skip = 1, .audible = true},
+    [TamaSpeedHalf] = {.ratio = 1, .slowdown = 2, .frame_skip = 1, .audible = true},
+    [TamaSpeed1x] = {.ratio = 1, .slowdown = 1, .frame_skip = 1, .audible = true},
+    [TamaSpeed2x] = {.ratio = 2, .slowdown = 1, .frame_skip = 1, .audible = true},
+    [TamaSpeed4x] = {.ratio = 4, .slowdown = 1, .frame_skip = 2, .audible = false},
+    [TamaSpeed8x] = {.ratio = 8, .slowdown = 1, .frame_skip = 3, .audible = false},
+    [TamaSpeed16x] = {.ratio = 16, .slowdown = 1, .frame_skip = 4, .audible = false},
+    [TamaSpeed32x] = {.ratio = 32, .slowdown = 1, .frame_skip = 6, .audible = false},
+    [TamaSpeed64x] = {.ratio = 64, .slowdown = 1, .frame_skip = 8, .audible = false},
+    [TamaSpeedMax] = {.ratio = 0, .slowdown = 1, .frame_skip = 8, .audible = false},
+};
+
 static void* tama_p1_hal_malloc(u32_t size) {
-    return malloc(size);
+    return tama_arena_alloc(&g_ctx->arena, size);
 }
 
 static void tama_p1_hal_free(void* ptr) {
-    free(ptr);
+    // Returned with the rest of the arena when the session ends
+    UNUSED(ptr);
 }
 
 static void tama_p1_hal_halt(void) {
@@ -19,6 +40,14 @@ static void tama_p1_hal_halt(void) {
 }
 
 static bool_t tama_p1_hal_is_log_enabled(log_level_t level) {
+#if defined(TAMA_PROFILE_RELEASE)
+    UNUSED(level);
+    return false;
+#elif defined(TAMA_PROFILE_DIAG)
+    // CPU and memory tracing included
+    UNUSED(level);
+    return true;
+#else
     switch(level) {
     case LOG_ERROR:
         return true;
@@ -31,10 +60,14 @@ static bool_t tama_p1_hal_is_log_enabled(log_level_t level) {
     default:
         return false;
     }
+#endif
 }
 
 static void tama_p1_hal_log(log_level_t level, char* buff, ...) {
     if(!tama_p1_hal_is_log_enabled(level)) return;
+#ifdef TAMA_PROFILE_DIAG
+    g_ctx->diag.logs++;
+#endif
 
     FuriString* string = furi_string_alloc();
     va_list args;
@@ -62,35 +95,124 @@ static void tama_p1_hal_log(log_level_t level, char* buff, ...) {
     furi_string_free(string);
 }
 
+static void tama_p1_hal_yield(uint32_t ticks) {
+    // This is the only place we know whether we're ahead or behind, so the mutex
+    // is released here rather than around the step call, where we would always
+    // have to delay and run more and more behind.
+    furi_mutex_release(g_ctx->state_mutex);
+    if(ticks) {
+        // Input wakes us early so a long low power sleep doesn't delay it
+        uint32_t start = furi_get_tick();
+        furi_thread_flags_wait(
+            TAMA_WORKER_FLAG_EXIT | TAMA_WORKER_FLAG_WAKE,
+            FuriFlagWaitAny | FuriFlagNoClear,
+            ticks);
+        furi_thread_flags_clear(TAMA_WORKER_FLAG_WAKE);
+        if(g_ctx->low_power.reasons) g_ctx->low_power.slept += furi_get_tick() - start;
+    } else {
+        furi_thread_yield();
+    }
+    while(furi_mutex_acquire(g_ctx->state_mutex, FuriWaitForever) != FuriStatusOk)
+        furi_delay_tick(1);
+}
+
+static void tama_p1_hal_clock_rebase(void) {
+    TamaClock* clock = &g_ctx->clock;
+    uint32_t count = LL_TIM_GetCounter(TIM2);
+    uint32_t elapsed = count - clock->timer_base;
+
+    clock->base += elapsed / clock->slowdown;
+    clock->timer_base = count - elapsed % clock->slowdown;
+}
+
 static void tama_p1_hal_sleep_until(timestamp_t ts) {
-    while(true) {
-        uint32_t count = LL_TIM_GetCounter(TIM2);
-        uint32_t delay = ts - count;
-        // FURI_LOG_D(TAG, "delay: %x", delay);
-        // Stolen from furi_delay_until_tick
-        if(delay != 0 && 0 == (delay >> (8 * sizeof(uint32_t) - 1))) {
-            // Not the best place to release mutex, but this is the only place we know whether
-            // we're ahead or behind, otherwise around the step call we'll always have to
-            // delay a tick and run more and more behind.
-            furi_mutex_release(g_state_mutex);
-            furi_delay_tick(1);
-            while(furi_mutex_acquire(g_state_mutex, FuriWaitForever) != FuriStatusOk)
-                furi_delay_tick(1);
-        } else {
-            break;
+    TamaClock* clock = &g_ctx->clock;
+    TamaSched* sched = &g_ctx->sched;
+    uint32_t deadline =
+        clock->timer_base + (uint32_t)((int32_t)(ts - clock->base) * clock->slowdown);
+    // Wrap-safe: TIM2 wraps every ~18h, lag stays valid for +/- 9h
+    int32_t lag = (int32_t)(LL_TIM_GetCounter(TIM2) - deadline);
+
+#ifdef TAMA_PROFILE_DIAG
+    g_ctx->diag.sleeps++;
+#endif
+#ifndef TAMA_PROFILE_RELEASE
+    sched->drift = lag;
+    if(lag > sched->drift_max) sched->drift_max = lag;
+#endif
+
+    if(lag < 0) {
+        sched->burst_len = 0;
+        // Less than a kernel tick ahead: keep going, the next deadlines chain on
+        // from this one so nothing is lost, we just sleep a little later. In low
+        // power we run a long batch ahead of time and then sleep it all off.
+        int32_t slack = g_ctx->low_power.reasons ? TAMA_LOWPOWER_SLACK : TAMA_SCHED_SLEEP_MIN;
+        if(-lag < slack) return;
+
+        // Block once for the whole lead instead of polling tick by tick
+#ifndef TAMA_PROFILE_RELEASE
+        sched->sleeps++;
+#endif
+        tama_p1_hal_yield((uint32_t)-lag / TAMA_SCHED_SLEEP_MIN);
+    } else {
+        // Behind: catch up back to back, but hand the state over to input and
+        // saves every so often so a long catch-up doesn't lock them out.
+#ifndef TAMA_PROFILE_RELEASE
+        sched->late_steps++;
+#endif
+        if(++sched->burst_len >= TAMA_SCHED_BURST_MAX) {
+            sched->burst_len = 0;
+#ifndef TAMA_PROFILE_RELEASE
+            sched->bursts++;
+#endif
+            tama_p1_hal_yield(0);
         }
     }
 }
 
 static timestamp_t tama_p1_hal_get_timestamp(void) {
-    return LL_TIM_GetCounter(TIM2);
+    TamaClock* clock = &g_ctx->clock;
+    uint32_t elapsed = LL_TIM_GetCounter(TIM2) - clock->timer_base;
+
+    if(clock->slowdown == 1) return clock->base + elapsed;
+
+    // Rebase well before TIM2 wraps past timer_base
+    if(elapsed >= (1UL << 30)) {
+        tama_p1_hal_clock_rebase();
+        elapsed = LL_TIM_GetCounter(TIM2) - clock->timer_base;
+    }
+    return clock->base + elapsed / clock->slowdown;
 }
 
 static void tama_p1_hal_update_screen(void) {
     // Do nothing, covered by main loop
 }
 
+#ifdef TAMA_LCD_LAZY
+// Display memory is decoded when a frame is drawn, see tama_p1_hal_lcd_sync
 static void tama_p1_hal_set_lcd_matrix(u8_t x, u8_t y, bool_t val) {
+    UNUSED(x);
+    UNUSED(y);
+    UNUSED(val);
+#ifdef TAMA_PROFILE_DIAG
+    g_ctx->diag.lcd_matrix++;
+#endif
+    g_ctx->lcd_dirty = true;
+}
+
+static void tama_p1_hal_set_lcd_icon(u8_t icon, bool_t val) {
+    UNUSED(icon);
+    UNUSED(val);
+#ifdef TAMA_PROFILE_DIAG
+    g_ctx->diag.lcd_icon++;
+#endif
+    g_ctx->lcd_dirty = true;
+}
+#else
+static void tama_p1_hal_set_lcd_matrix(u8_t x, u8_t y, bool_t val) {
+#ifdef TAMA_PROFILE_DIAG
+    g_ctx->diag.lcd_matrix++;
+#endif
     if(val)
         g_ctx->framebuffer[y] |= 1 << x;
     else
@@ -98,30 +220,143 @@ static void tama_p1_hal_set_lcd_matrix(u8_t x, u8_t y, bool_t val) {
 }
 
 static void tama_p1_hal_set_lcd_icon(u8_t icon, bool_t val) {
+#ifdef TAMA_PROFILE_DIAG
+    g_ctx->diag.lcd_icon++;
+#endif
     if(val)
         g_ctx->icons |= 1 << icon;
     else
         g_ctx->icons &= ~(1 << icon);
 }
+#endif
+
+void tama_p1_hal_low_power(TamaLowPowerReason reason, bool enabled) {
+    TamaLowPower* low_power = &g_ctx->low_power;
+
+    // Set from the GUI and timer threads, read by the worker
+    FURI_CRITICAL_ENTER();
+    uint8_t reasons = enabled ? low_power->reasons | reason : low_power->reasons & ~reason;
+    if(!low_power->reasons && reasons) {
+        low_power->since = furi_get_tick();
+        low_power->entries++;
+    } else if(low_power->reasons && !reasons) {
+        low_power->ticks += furi_get_tick() - low_power->since;
+    }
+    low_power->reasons = reasons;
+    FURI_CRITICAL_EXIT();
+}
+
+void tama_p1_hal_lcd_sync(void) {
+#ifdef TAMA_LCD_LAZY
+    // Display memory belongs to another pet during a daycare visit
+    if(!g_ctx->lcd_dirty || g_ctx->background) return;
+    // Cleared first so writes racing with the decode mark the next frame
+    g_ctx->lcd_dirty = false;
+    tama_lcd_decode(tamalib_get_state()->memory, g_ctx->framebuffer, &g_ctx->icons);
+#endif
+}
+
+static void tama_p1_hal_buzzer_post(const TamaBuzzerEvent* event) {
+    // Never block the CPU core on audio; a full queue means the consumer is
+    // stuck and dropping a change is the lesser evil. Counted only, logging
+    // here would put the UART back into the step.
+    if(furi_message_queue_put(g_ctx->buzzer_queue, event, 0) != FuriStatusOk)
+        g_ctx->buzzer_dropped++;
+}
 
 static void tama_p1_hal_play_frequency(bool_t en) {
-    if(en && !g_ctx->buzzer_mute) {
+    TamaBuzzerEvent event;
+#ifdef TAMA_PROFILE_DIAG
+    g_ctx->diag.play_frequency++;
+#endif
+    if(tama_buzzer_play(&g_ctx->buzzer, en, *tamalib_get_state()->tick_counter, &event))
+        tama_p1_hal_buzzer_post(&event);
+}
+
+static void tama_p1_hal_set_frequency(u32_t freq) {
+    TamaBuzzerEvent event;
+#ifdef TAMA_PROFILE_DIAG
+    g_ctx->diag.set_frequency++;
+#endif
+    if(tama_buzzer_set_frequency(
+           &g_ctx->buzzer, freq, *tamalib_get_state()->tick_counter, &event))
+        tama_p1_hal_buzzer_post(&event);
+}
+
+static bool tama_p1_hal_buzzer_apply(const TamaBuzzerEvent* event) {
+    if(event->frequency != TAMA_BUZZER_SILENT && !g_ctx->buzzer_mute && g_ctx->buzzer_audible) {
+        // Acquire once per tone and only retune while it lasts
         if(furi_hal_speaker_is_mine() || furi_hal_speaker_acquire(30)) {
-            furi_hal_speaker_start(g_ctx->frequency, 0.5f);
+            furi_hal_speaker_start(event->frequency / 10.0F, 0.5f);
+            return true;
         }
-    } else {
-        if(furi_hal_speaker_is_mine()) {
-            furi_hal_speaker_stop();
+    } else if(furi_hal_speaker_is_mine()) {
+        furi_hal_speaker_stop();
+    }
+    return false;
+}
+
+static int32_t tama_p1_hal_audio_worker(void* context) {
+    FuriMessageQueue* queue = context;
+    TamaBuzzerEvent event;
+    bool playing = false;
+
+    while(true) {
+        // Hold on to the speaker between notes of a melody, give it back once
+        // the buzzer has been quiet for a while.
+        uint32_t timeout = furi_hal_speaker_is_mine() && !playing ?
+                               furi_ms_to_ticks(TAMA_AUDIO_RELEASE_MS) :
+                               FuriWaitForever;
+        if(furi_message_queue_get(queue, &event, timeout) != FuriStatusOk) {
             furi_hal_speaker_release();
+            continue;
         }
+
+        if(event.tick == TAMA_AUDIO_EXIT_TICK && event.frequency == TAMA_AUDIO_EXIT_FREQ) break;
+        playing = tama_p1_hal_buzzer_apply(&event);
     }
 
-    g_ctx->buzzer_on = en;
+    if(furi_hal_speaker_is_mine()) {
+        furi_hal_speaker_stop();
+        furi_hal_speaker_release();
+    }
+    return 0;
 }
 
-static void tama_p1_hal_set_frequency(u32_t freq) {
-    g_ctx->frequency = freq / 10.0F;
-    if(g_ctx->buzzer_on) tama_p1_hal_play_frequency(true);
+void tama_p1_hal_buzzer_sync(void) {
+    // Re-evaluates mute and audibility against the current output
+    TamaBuzzerEvent event = {
+        .tick = *tamalib_get_state()->tick_counter,
+        .frequency = g_ctx->buzzer.output,
+    };
+    tama_p1_hal_buzzer_post(&event);
+}
+
+void tama_p1_hal_audio_start(void) {
+    tama_buzzer_reset(&g_ctx->buzzer);
+    g_ctx->buzzer_dropped = 0;
+    g_ctx->buzzer_queue = furi_message_queue_alloc(TAMA_AUDIO_QUEUE_SIZE, sizeof(TamaBuzzerEvent));
+    g_ctx->audio_thread = furi_thread_alloc();
+    furi_thread_set_name(g_ctx->audio_thread, "TamaAudio");
+    furi_thread_set_stack_size(g_ctx->audio_thread, 1024);
+    furi_thread_set_callback(g_ctx->audio_thread, tama_p1_hal_audio_worker);
+    furi_thread_set_context(g_ctx->audio_thread, g_ctx->buzzer_queue);
+    furi_thread_start(g_ctx->audio_thread);
+}
+
+void tama_p1_hal_audio_stop(void) {
+    TamaBuzzerEvent event = {
+        .tick = TAMA_AUDIO_EXIT_TICK,
+        .frequency = TAMA_AUDIO_EXIT_FREQ,
+    };
+    furi_message_queue_put(g_ctx->buzzer_queue, &event, FuriWaitForever);
+    furi_thread_join(g_ctx->audio_thread);
+    furi_thread_free(g_ctx->audio_thread);
+    furi_message_queue_free(g_ctx->buzzer_queue);
+    g_ctx->audio_thread = NULL;
+    g_ctx->buzzer_queue = NULL;
+    if(g_ctx->buzzer_dropped)
+        FURI_LOG_W(TAG_HAL, "Buzzer queue full, %lu events dropped", g_ctx->buzzer_dropped);
 }
 
 static int tama_p1_hal_handler(void) {
@@ -129,7 +364,69 @@ static int tama_p1_hal_handler(void) {
     return 0;
 }
 
-void tama_p1_hal_init(hal_t* hal) {
+void tama_p1_hal_set_speed(TamaSpeed speed) {
+    furi_assert(speed < TamaSpeedNum);
+    const TamaSpeedConfig* config = &speed_configs[speed];
+
+    // Keep the emulated clock continuous across the divider change
+    tama_p1_hal_clock_rebase();
+    g_ctx->clock.slowdown = config->slowdown;
+
+    bool unthrottled = g_ctx->cpu_speed == TamaSpeedMax;
+    g_ctx->cpu_speed = speed;
+    if(speed == TamaSpeedMax) {
+        g_ctx->worker_events |= TamaWorkerEventBurst;
+    } else {
+        g_ctx->worker_events &= ~TamaWorkerEventBurst;
+    }
+    g_ctx->frame_skip = config->frame_skip;
+    g_ctx->buzzer_audible = config->audible;
+    tama_p1_hal_buzzer_sync();
+
+    tamalib_set_speed(config->ratio);
+    // Unthrottled runs leave the reference timestamp behind, don't try to catch
+    // up on them. Lag from any other speed is still owed and caught up on.
+    if(unthrottled && speed != TamaSpeedMax) cpu_sync_ref_timestamp();
+}
+
+void tama_p1_hal_background(bool background) {
+    // Held so the update timer never decodes a pet that isn't shown
+    furi_mutex_acquire(g_ctx->draw_mutex, FuriWaitForever);
+    if(background) {
+        tama_p1_hal_lcd_sync();
+        tamalib_register_hal(&g_ctx->hal_background);
+        tamalib_set_speed(0);
+    } else {
+        tamalib_register_hal(&g_ctx->hal);
+        // No resync: the shown pet catches up on the time the visit took
+        tamalib_set_speed(speed_configs[g_ctx->cpu_speed].ratio);
+        tama_lcd_decode(tamalib_get_state()->memory, g_ctx->framebuffer, &g_ctx->icons);
+        g_ctx->lcd_dirty = false;
+    }
+    g_ctx->background = background;
+    furi_mutex_release(g_ctx->draw_mutex);
+}
+
+static void tama_p1_hal_background_lcd_matrix(u8_t x, u8_t y, bool_t val) {
+    UNUSED(x);
+    UNUSED(y);
+    UNUSED(val);
+}
+
+static void tama_p1_hal_background_lcd_icon(u8_t icon, bool_t val) {
+    UNUSED(icon);
+    UNUSED(val);
+}
+
+static void tama_p1_hal_background_set_frequency(u32_t freq) {
+    UNUSED(freq);
+}
+
+static void tama_p1_hal_background_play_frequency(bool_t en) {
+    UNUSED(en);
+}
+
+void tama_p1_hal_init(hal_t* hal, hal_t* background) {
     hal->malloc = tama_p1_hal_malloc;
     hal->free = tama_p1_hal_free;
     hal->halt = tama_p1_hal_halt;
@@ -143,4 +440,10 @@ void tama_p1_hal_init(hal_t* hal) {
     hal->set_frequency = tama_p1_hal_set_frequency;
     hal->play_frequency = tama_p1_hal_play_frequency;
     hal->handler = tama_p1_hal_handler;
+
+    *background = *hal;
+    background->set_lcd_matrix = tama_p1_hal_background_lcd_matrix;
+    background->set_lcd_icon = tama_p1_hal_background_lcd_icon;
+    background->set_frequency = tama_p1_hal_background_set_frequency;
+    background->play_frequency = tama_p1_hal_background_play_frequency;
 }
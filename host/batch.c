@@ -0,0 +1,198 @@
+/*
+ * Batch runner: spreads many headless simulations over all cores.
+ *
+ * TamaLIB keeps its CPU state in statics, so every simulation gets a process
+ * of its own; up to -j of them run at a time, each taking the next job from
+ * the list as soon as a slot frees up. Each line of the job file holds the
+ * same arguments tama_host takes, e.g.
+ *
+ *   -t 86400 -s pet1.sav rom.bin
+ *   -m day2.mov -g day2.golden rom.bin
+ *
+ * Blank lines and lines starting with # are skipped.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "tama_host.h"
+
+#define TAMA_BATCH_MAX_ARGS 32
+
+typedef struct {
+    char* line;
+    int line_number;
+    pid_t pid;
+} TamaBatchJob;
+
+typedef struct {
+    TamaHostResult result;
+    bool ok;
+} TamaBatchSlot;
+
+static void tama_batch_usage(const char* name) {
+    fprintf(stderr, "Usage: %s [-j processes] jobs.txt|-\n", name);
+    fprintf(stderr, "  -j  simulations run at once (default: online CPUs)\n");
+}
+
+static int tama_batch_run_job(const TamaBatchJob* job, TamaBatchSlot* slot) {
+    char* argv[TAMA_BATCH_MAX_ARGS + 1];
+    int argc = 0;
+    TamaHostJob host_job;
+
+    argv[argc++] = "tama_batch";
+    for(char* tok = strtok(job->line, " \t\r\n"); tok != NULL && argc < TAMA_BATCH_MAX_ARGS;
+        tok = strtok(NULL, " \t\r\n"))
+        argv[argc++] = tok;
+    argv[argc] = NULL;
+
+    if(tama_host_parse_args(argc, argv, &host_job) <= 0) {
+        fprintf(stderr, "Line %d: bad arguments\n", job->line_number);
+        return 1;
+    }
+
+    slot->ok = tama_host_run(&host_job, &slot->result);
+    return slot->ok && !slot->result.diverged ? 0 : 1;
+}
+
+static size_t tama_batch_read_jobs(FILE* file, TamaBatchJob** jobs) {
+    size_t count = 0;
+    size_t capacity = 0;
+    char* line = NULL;
+    size_t line_size = 0;
+    int line_number = 0;
+
+    *jobs = NULL;
+    while(getline(&line, &line_size, file) != -1) {
+        line_number++;
+        char* start = line + strspn(line, " \t\r\n");
+        if(*start == '\0' || *start == '#') continue;
+
+        if(count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            *jobs = realloc(*jobs, capacity * sizeof(TamaBatchJob));
+        }
+        (*jobs)[count].line = strdup(start);
+        (*jobs)[count].line_number = line_number;
+        (*jobs)[count].pid = 0;
+        count++;
+    }
+
+    free(line);
+    return count;
+}
+
+static double tama_batch_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv) {
+    long processes = sysconf(_SC_NPROCESSORS_ONLN);
+    int opt;
+
+    while((opt = getopt(argc, argv, "j:h")) != -1) {
+        switch(opt) {
+        case 'j':
+            processes = strtol(optarg, NULL, 0);
+            break;
+        default:
+            tama_batch_usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if(optind != argc - 1 || processes < 1) {
+        tama_batch_usage(argv[0]);
+        return 1;
+    }
+
+    FILE* file = strcmp(argv[optind], "-") ? fopen(argv[optind], "r") : stdin;
+    if(file == NULL) {
+        fprintf(stderr, "Cannot open \"%s\"\n", argv[optind]);
+        return 1;
+    }
+
+    TamaBatchJob* jobs;
+    size_t count = tama_batch_read_jobs(file, &jobs);
+    if(file != stdin) fclose(file);
+    if(count == 0) return 0;
+
+    // Children report back through memory shared across fork()
+    TamaBatchSlot* slots = mmap(
+        NULL,
+        count * sizeof(TamaBatchSlot),
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_ANONYMOUS,
+        -1,
+        0);
+    if(slots == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    memset(slots, 0, count * sizeof(TamaBatchSlot));
+
+    double start = tama_batch_now();
+    size_t next = 0;
+    long running = 0;
+
+    fflush(stdout);
+    while(next < count || running > 0) {
+        if(next < count && running < processes) {
+            pid_t pid = fork();
+            if(pid == 0) _exit(tama_batch_run_job(&jobs[next], &slots[next]));
+            if(pid < 0) {
+                perror("fork");
+                break;
+            }
+            jobs[next++].pid = pid;
+            running++;
+        } else if(wait(NULL) > 0) {
+            running--;
+        }
+    }
+
+    double elapsed = tama_batch_now() - start;
+    uint64_t total_ticks = 0;
+    size_t failed = 0;
+
+    printf("line  status  emulated_s        steps  hash      wall_s\n");
+    for(size_t i = 0; i < count; i++) {
+        TamaBatchSlot* slot = &slots[i];
+        if(!slot->ok) {
+            printf("%4d  failed\n", jobs[i].line_number);
+            failed++;
+        } else {
+            printf(
+                "%4d  %-6s  %10.1f  %11llu  %08x  %6.2f\n",
+                jobs[i].line_number,
+                slot->result.diverged ? "diverg" :
+                slot->result.halted   ? "halted" :
+                                        "ok",
+                (double)slot->result.ticks / TICK_FREQUENCY,
+                (unsigned long long)slot->result.steps,
+                slot->result.hash,
+                slot->result.elapsed);
+            total_ticks += slot->result.ticks;
+            if(slot->result.diverged) failed++;
+        }
+        free(jobs[i].line);
+    }
+
+    printf(
+        "%zu jobs (%zu failed or diverged) on %ld processes: %.1f emulated s in %.2f s (%.0fx)\n",
+        count,
+        failed,
+        processes,
+        (double)total_ticks / TICK_FREQUENCY,
+        elapsed,
+        elapsed > 0 ? (double)total_ticks / TICK_FREQUENCY / elapsed : 0);
+
+    munmap(slots, count * sizeof(TamaBatchSlot));
+    free(jobs);
+    return failed ? 1 : 0;
+}
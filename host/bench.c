@@ -0,0 +1,184 @@
+/*
+ * Render path microbenchmark. Runs the game and menu views against the Furi
+ * shim in shim/ and reports canvas calls and time per frame for a few LCD
+ * contents, and the cost of the input and menu callbacks, so changes to the
+ * render path can be compared without a Flipper.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "shim/shim.h"
+#include "../tama.h"
+#include "../views/tama_game.h"
+#include "../views/tama_menu.h"
+
+#define TAMA_BENCH_DEFAULT_ITERATIONS 20000
+
+TamaApp* g_ctx;
+static TamaApp bench_ctx;
+static uint8_t bench_rom[2];
+static uint32_t bench_inputs;
+
+// The HAL and worker side of the app is not part of the render path
+void tama_p1_hal_lcd_sync(void) {
+}
+
+void tama_p1_hal_low_power(TamaLowPowerReason reason, bool enabled) {
+    UNUSED(reason);
+    UNUSED(enabled);
+}
+
+void tama_p1_hal_set_speed(TamaSpeed speed) {
+    g_ctx->cpu_speed = speed;
+}
+
+void tama_p1_hal_buzzer_sync(void) {
+}
+
+bool tama_p1_daycare_show(uint8_t index) {
+    g_ctx->daycare.shown = index;
+    return true;
+}
+
+void tama_p1_input_push(button_t button, btn_state_t state) {
+    UNUSED(button);
+    UNUSED(state);
+    bench_inputs++;
+}
+
+typedef struct {
+    const char* name;
+    uint32_t framebuffer[16];
+    uint8_t icons;
+} TamaBenchScene;
+
+static void tama_bench_scenes(TamaBenchScene* scenes) {
+    // Blank is the pet asleep, sparse a typical sprite with a couple of icons
+    memset(scenes, 0, 3 * sizeof(TamaBenchScene));
+    scenes[0].name = "blank";
+
+    scenes[1].name = "sparse";
+    uint32_t seed = 1;
+    for(uint8_t row = 3; row < 13; row++) {
+        for(uint8_t col = 8; col < 24; col++) {
+            seed = seed * 1103515245 + 12345;
+            if((seed >> 16) % 3 == 0) scenes[1].framebuffer[row] |= 1UL << col;
+        }
+    }
+    scenes[1].icons = 0x05;
+
+    scenes[2].name = "full";
+    memset(scenes[2].framebuffer, 0xFF, sizeof(scenes[2].framebuffer));
+    scenes[2].icons = 0xFF;
+}
+
+static double tama_bench_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+static void tama_bench_report(const char* name, double start, uint32_t iterations) {
+    printf("%-12s %10s %10s %12.0f\n", name, "-", "-", (tama_bench_now() - start) / iterations);
+}
+
+static void tama_bench_usage(const char* name) {
+    fprintf(stderr, "Usage: %s [-n iterations]\n", name);
+    fprintf(
+        stderr,
+        "  -n  frames and callbacks timed per case (default %d)\n",
+        TAMA_BENCH_DEFAULT_ITERATIONS);
+}
+
+int main(int argc, char** argv) {
+    uint32_t iterations = TAMA_BENCH_DEFAULT_ITERATIONS;
+    int opt;
+
+    while((opt = getopt(argc, argv, "n:h")) != -1) {
+        switch(opt) {
+        case 'n':
+            iterations = strtoul(optarg, NULL, 0);
+            break;
+        case 'h':
+            tama_bench_usage(argv[0]);
+            return 0;
+        default:
+            tama_bench_usage(argv[0]);
+            return 1;
+        }
+    }
+    if(optind != argc || iterations == 0) {
+        tama_bench_usage(argv[0]);
+        return 1;
+    }
+
+    g_ctx = &bench_ctx;
+    g_ctx->state_mutex = furi_mutex_alloc(FuriMutexTypeRecursive);
+    g_ctx->draw_mutex = furi_mutex_alloc(FuriMutexTypeRecursive);
+    g_ctx->rom = bench_rom;
+    g_ctx->cpu_speed = TamaSpeed1x;
+
+    TamaGame* tama_game = tama_game_alloc();
+    TamaMenu* tama_menu = tama_menu_alloc();
+    View* game_view = tama_game_get_view(tama_game);
+    View* menu_view = tama_menu_get_view(tama_menu);
+    Canvas* canvas = canvas_shim_alloc();
+
+    TamaBenchScene scenes[3];
+    tama_bench_scenes(scenes);
+
+    printf("%-12s %10s %10s %12s\n", "case", "calls", "pixels", "ns/call");
+    for(size_t i = 0; i < COUNT_OF(scenes); i++) {
+        memcpy(g_ctx->framebuffer, scenes[i].framebuffer, sizeof(g_ctx->framebuffer));
+        g_ctx->icons = scenes[i].icons;
+
+        // One frame to count what it draws, then timed without resets
+        canvas_shim_reset(canvas);
+        view_shim_draw(game_view, canvas);
+        uint32_t calls = canvas_shim_draw_calls(canvas);
+        uint32_t pixels = 0;
+        for(int32_t y = 0; y < CANVAS_SHIM_HEIGHT; y++) {
+            for(int32_t x = 0; x < CANVAS_SHIM_WIDTH; x++)
+                pixels += canvas_shim_get_pixel(canvas, x, y);
+        }
+
+        double start = tama_bench_now();
+        for(uint32_t n = 0; n < iterations; n++)
+            view_shim_draw(game_view, canvas);
+        double elapsed = tama_bench_now() - start;
+
+        printf(
+            "draw %-7s %10u %10u %12.0f\n", scenes[i].name, calls, pixels, elapsed / iterations);
+    }
+
+    InputEvent event = {.key = InputKeyOk};
+    double start = tama_bench_now();
+    for(uint32_t n = 0; n < iterations; n++) {
+        event.type = n & 1 ? InputTypeRelease : InputTypePress;
+        event.sequence = n;
+        view_shim_input(game_view, &event);
+    }
+    tama_bench_report("input", start, iterations);
+
+    VariableItem* speed = variable_item_list_shim_find(menu_view, "CPU Speed");
+    start = tama_bench_now();
+    for(uint32_t n = 0; n < iterations; n++)
+        variable_item_list_shim_change(speed, TamaSpeed1x + (n & 1));
+    tama_bench_report("menu speed", start, iterations);
+
+    VariableItem* mute = variable_item_list_shim_find(menu_view, "Buzzer Mute");
+    start = tama_bench_now();
+    for(uint32_t n = 0; n < iterations; n++)
+        variable_item_list_shim_change(mute, n & 1);
+    tama_bench_report("menu mute", start, iterations);
+
+    canvas_shim_free(canvas);
+    tama_menu_free(tama_menu);
+    tama_game_free(tama_game);
+    furi_mutex_free(g_ctx->state_mutex);
+    furi_mutex_free(g_ctx->draw_mutex);
+
+    if(bench_inputs != iterations) fprintf(stderr, "Lost %u inputs\n", iterations - bench_inputs);
+    return 0;
+}
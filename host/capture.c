@@ -0,0 +1,58 @@
+#include <stdio.h>
+#include <string.h>
+#include "tama_host.h"
+
+/*
+ * Samples the LCD at TAMA_HOST_CAPTURE_RATE frames per emulated second, the
+ * update timer rate on the device, into the same capture format.
+ */
+
+bool tama_host_capture_open(const char* path) {
+    TamaHostCapture* capture = &g_host.capture;
+    uint8_t header[TAMA_CAPTURE_HEADER_SIZE];
+
+    capture->file = fopen(path, "wb");
+    if(capture->file == NULL) {
+        fprintf(stderr, "Cannot create \"%s\"\n", path);
+        return false;
+    }
+
+    fwrite(header, 1, tama_capture_header(header), capture->file);
+    capture->samples = 0;
+    capture->next_tick = 0;
+    capture->last_tick = 0;
+    capture->key = true;
+    return true;
+}
+
+void tama_host_capture_sample(uint64_t ticks) {
+    TamaHostCapture* capture = &g_host.capture;
+    uint8_t buf[TAMA_CAPTURE_FRAME_MAX];
+
+    capture->samples++;
+    capture->next_tick = capture->samples * TICK_FREQUENCY / TAMA_HOST_CAPTURE_RATE;
+
+    tama_host_lcd_sync();
+    size_t size = tama_capture_frame_encode(
+        buf,
+        (uint32_t)(ticks - capture->last_tick),
+        capture->key ? NULL : capture->framebuffer,
+        capture->icons,
+        g_host.framebuffer,
+        g_host.icons);
+    if(size == 0) return;
+
+    fwrite(buf, 1, size, capture->file);
+    memcpy(capture->framebuffer, g_host.framebuffer, sizeof(capture->framebuffer));
+    capture->icons = g_host.icons;
+    capture->last_tick = ticks;
+    capture->key = false;
+    capture->frames++;
+}
+
+void tama_host_capture_close(void) {
+    TamaHostCapture* capture = &g_host.capture;
+
+    if(capture->file != NULL) fclose(capture->file);
+    capture->file = NULL;
+}
@@ -0,0 +1,201 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tama_host.h"
+
+/*
+ * Interactive debugger for tama_debug, which is tama_host built with
+ * TAMA_DEBUGGER. The run loop only calls tama_host_debug_check while
+ * something is armed, and a PC breakpoint costs a page mask test for every
+ * PC outside the pages that have one. Commands, one per line on stdin:
+ *
+ *   s [n]        step n instructions (1)
+ *   c            continue until a breakpoint or watchpoint hits
+ *   b [addr]     set a PC breakpoint, or list them
+ *   bd addr      delete a PC breakpoint
+ *   w [addr]     watch a RAM or I/O nibble for changes, or list them
+ *   wd addr      delete a watchpoint
+ *   r            dump the registers
+ *   m addr [n]   dump n memory nibbles (16)
+ *   q            stop the run
+ */
+
+#ifdef TAMA_DEBUGGER
+
+#define TAMA_DEBUG_LINE_MAX 128
+
+static bool tama_host_debug_breakpoint(uint16_t pc) {
+    return (g_host.debug.pages >> (pc >> TAMA_DEBUG_PAGE_BITS)) & 1 &&
+           (g_host.debug.breakpoints[pc / 8] >> (pc % 8)) & 1;
+}
+
+static void tama_host_debug_arm(void) {
+    TamaHostDebug* debug = &g_host.debug;
+    debug->armed = debug->breakpoint_count > 0 || debug->watch_count > 0 || debug->steps > 0;
+}
+
+static void tama_host_debug_registers(void) {
+    const state_t* state = tamalib_get_state();
+    uint16_t pc = *state->pc;
+    uint8_t flags = *state->flags;
+    const u12_t* program = (const u12_t*)g_host.rom;
+    size_t words = g_host.rom_size / 2;
+
+    printf(
+        "pc %04x np %02x a %x b %x x %03x y %03x sp %02x flags %c%c%c%c tick %" PRIu32,
+        pc,
+        *state->np,
+        *state->a,
+        *state->b,
+        *state->x,
+        *state->y,
+        *state->sp,
+        flags & 0x8 ? 'I' : '-',
+        flags & 0x4 ? 'D' : '-',
+        flags & 0x2 ? 'Z' : '-',
+        flags & 0x1 ? 'C' : '-',
+        *state->tick_counter);
+    if(pc < words) printf(" op %03x", program[pc]);
+    printf("\n");
+}
+
+static void tama_host_debug_memory(uint16_t addr, uint32_t count) {
+    for(uint32_t i = 0; i < count; i++) {
+        if(i % 16 == 0) printf(i ? "\n%03x " : "%03x ", (addr + i) & 0xFFF);
+        printf(" %x", tama_host_memory((addr + i) & 0xFFF));
+    }
+    printf("\n");
+}
+
+static bool tama_host_debug_set_breakpoint(uint16_t pc, bool set) {
+    TamaHostDebug* debug = &g_host.debug;
+    uint8_t bit = 1 << (pc % 8);
+
+    if(pc >= TAMA_DEBUG_PC_SIZE) return false;
+    if(set == ((debug->breakpoints[pc / 8] & bit) != 0)) return true;
+
+    if(set) {
+        debug->breakpoints[pc / 8] |= bit;
+        debug->breakpoint_count++;
+        debug->pages |= 1UL << (pc >> TAMA_DEBUG_PAGE_BITS);
+        return true;
+    }
+
+    debug->breakpoints[pc / 8] &= ~bit;
+    debug->breakpoint_count--;
+    // Drop the page once its last breakpoint is gone
+    uint16_t page = pc >> TAMA_DEBUG_PAGE_BITS;
+    for(uint16_t i = page << TAMA_DEBUG_PAGE_BITS; i < (page + 1) << TAMA_DEBUG_PAGE_BITS; i++) {
+        if(tama_host_debug_breakpoint(i)) return true;
+    }
+    debug->pages &= ~(1UL << page);
+    return true;
+}
+
+static bool tama_host_debug_set_watch(uint16_t addr, bool set) {
+    TamaHostDebug* debug = &g_host.debug;
+    uint8_t i;
+
+    for(i = 0; i < debug->watch_count; i++) {
+        if(debug->watches[i].addr == addr) break;
+    }
+
+    if(set) {
+        if(i < debug->watch_count) return true;
+        if(debug->watch_count >= TAMA_DEBUG_WATCH_MAX) return false;
+        debug->watches[debug->watch_count].addr = addr;
+        debug->watches[debug->watch_count].value = tama_host_memory(addr);
+        debug->watch_count++;
+        return true;
+    }
+
+    if(i == debug->watch_count) return false;
+    debug->watches[i] = debug->watches[--debug->watch_count];
+    return true;
+}
+
+static void tama_host_debug_list(void) {
+    TamaHostDebug* debug = &g_host.debug;
+
+    for(uint16_t pc = 0; pc < TAMA_DEBUG_PC_SIZE; pc++) {
+        if(tama_host_debug_breakpoint(pc)) printf("break %04x\n", pc);
+    }
+    for(uint8_t i = 0; i < debug->watch_count; i++) {
+        printf("watch %03x = %x\n", debug->watches[i].addr, debug->watches[i].value);
+    }
+}
+
+bool tama_host_debug_check(void) {
+    TamaHostDebug* debug = &g_host.debug;
+    const state_t* state = tamalib_get_state();
+    bool hit = false;
+
+    if(debug->steps > 0 && --debug->steps == 0) {
+        tama_host_debug_arm();
+        hit = true;
+    }
+
+    if(debug->pages && tama_host_debug_breakpoint(*state->pc)) {
+        printf("break %04x\n", *state->pc);
+        hit = true;
+    }
+
+    for(uint8_t i = 0; i < debug->watch_count; i++) {
+        TamaDebugWatch* watch = &debug->watches[i];
+        uint8_t value = tama_host_memory(watch->addr);
+        if(value == watch->value) continue;
+        printf("watch %03x: %x -> %x\n", watch->addr, watch->value, value);
+        watch->value = value;
+        hit = true;
+    }
+
+    if(hit) debug->steps = 0;
+    return hit;
+}
+
+bool tama_host_debug_prompt(void) {
+    char line[TAMA_DEBUG_LINE_MAX];
+
+    tama_host_debug_registers();
+    while(true) {
+        printf("> ");
+        fflush(stdout);
+        if(fgets(line, sizeof(line), stdin) == NULL) return false;
+
+        char* cmd = strtok(line, " \t\r\n");
+        char* arg = strtok(NULL, " \t\r\n");
+        char* arg2 = strtok(NULL, " \t\r\n");
+        uint32_t value = arg != NULL ? strtoul(arg, NULL, 16) : 0;
+        if(cmd == NULL) continue;
+
+        if(!strcmp(cmd, "s")) {
+            g_host.debug.steps = arg != NULL ? strtoul(arg, NULL, 0) : 1;
+            if(g_host.debug.steps == 0) continue;
+            tama_host_debug_arm();
+            return true;
+        } else if(!strcmp(cmd, "c")) {
+            g_host.debug.steps = 0;
+            tama_host_debug_arm();
+            return true;
+        } else if(!strcmp(cmd, "q")) {
+            return false;
+        } else if(!strcmp(cmd, "r")) {
+            tama_host_debug_registers();
+        } else if(!strcmp(cmd, "m") && arg != NULL) {
+            tama_host_debug_memory(value, arg2 != NULL ? strtoul(arg2, NULL, 0) : 16);
+        } else if((!strcmp(cmd, "b") || !strcmp(cmd, "w")) && arg == NULL) {
+            tama_host_debug_list();
+        } else if(!strcmp(cmd, "b") || !strcmp(cmd, "bd")) {
+            if(!tama_host_debug_set_breakpoint(value, cmd[1] == '\0'))
+                printf("No PC %s\n", arg);
+        } else if(!strcmp(cmd, "w") || !strcmp(cmd, "wd")) {
+            if(!tama_host_debug_set_watch(value, cmd[1] == '\0'))
+                printf("Cannot %s watch %s\n", cmd[1] ? "delete" : "add", arg);
+        } else {
+            printf("Commands: s [n], c, b [addr], bd addr, w [addr], wd addr, r, m addr [n], q\n");
+        }
+    }
+}
+
+#endif
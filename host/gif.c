@@ -0,0 +1,258 @@
+/*
+ * Turns an LCD capture (.tcap, see tama_capture.h) into an animated GIF: the
+ * 32x16 matrix with the four icon slots above and below it, each frame shown
+ * for the emulated time until the next one.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <tamalib.h>
+#include "../tama_capture.h"
+
+#define TAMA_GIF_DEFAULT_SCALE 4
+#define TAMA_GIF_LAST_DELAY    100 // Centiseconds the last frame stays up
+#define TAMA_GIF_CODES_MAX     4096
+
+typedef struct {
+    FILE* file;
+    uint16_t width;
+    uint16_t height;
+    uint8_t* pixels;
+    // LZW output, packed LSB first into sub-blocks of up to 255 bytes
+    uint32_t bits;
+    uint8_t bit_count;
+    uint8_t block[255];
+    uint8_t block_len;
+    uint16_t codes[TAMA_GIF_CODES_MAX][2];
+    uint32_t frames;
+} TamaGif;
+
+static const uint8_t tama_gif_palette[] = {0xB4, 0xC4, 0xA8, 0x20, 0x28, 0x20};
+
+static void tama_gif_u16(FILE* file, uint16_t val) {
+    fputc(val & 0xFF, file);
+    fputc(val >> 8, file);
+}
+
+static void tama_gif_flush_block(TamaGif* gif) {
+    if(gif->block_len == 0) return;
+    fputc(gif->block_len, gif->file);
+    fwrite(gif->block, 1, gif->block_len, gif->file);
+    gif->block_len = 0;
+}
+
+static void tama_gif_put_code(TamaGif* gif, uint16_t code, uint8_t size) {
+    gif->bits |= (uint32_t)code << gif->bit_count;
+    gif->bit_count += size;
+    while(gif->bit_count >= 8) {
+        gif->block[gif->block_len++] = gif->bits & 0xFF;
+        if(gif->block_len == sizeof(gif->block)) tama_gif_flush_block(gif);
+        gif->bits >>= 8;
+        gif->bit_count -= 8;
+    }
+}
+
+static void tama_gif_lzw(TamaGif* gif) {
+    // Two colours, but GIF's smallest code size is 2 bits
+    const uint8_t min_size = 2;
+    const uint16_t clear = 1 << min_size;
+    uint16_t next = clear + 2;
+    uint8_t size = min_size + 1;
+    size_t count = (size_t)gif->width * gif->height;
+
+    fputc(min_size, gif->file);
+    memset(gif->codes, 0, sizeof(gif->codes));
+    tama_gif_put_code(gif, clear, size);
+
+    uint16_t prefix = gif->pixels[0];
+    for(size_t i = 1; i < count; i++) {
+        uint8_t pixel = gif->pixels[i];
+        if(gif->codes[prefix][pixel]) {
+            prefix = gif->codes[prefix][pixel];
+            continue;
+        }
+
+        tama_gif_put_code(gif, prefix, size);
+        if(next < TAMA_GIF_CODES_MAX) {
+            if(next == (1 << size)) size++;
+            gif->codes[prefix][pixel] = next++;
+        } else {
+            tama_gif_put_code(gif, clear, size);
+            memset(gif->codes, 0, sizeof(gif->codes));
+            next = clear + 2;
+            size = min_size + 1;
+        }
+        prefix = pixel;
+    }
+
+    tama_gif_put_code(gif, prefix, size);
+    tama_gif_put_code(gif, clear + 1, size);
+    if(gif->bit_count > 0) tama_gif_put_code(gif, 0, 8 - gif->bit_count);
+    tama_gif_flush_block(gif);
+    fputc(0, gif->file);
+}
+
+static void tama_gif_begin(TamaGif* gif) {
+    fwrite("GIF89a", 1, 6, gif->file);
+    tama_gif_u16(gif->file, gif->width);
+    tama_gif_u16(gif->file, gif->height);
+    fputc(0x80, gif->file); // Global colour table of 2 entries
+    fputc(0, gif->file);
+    fputc(0, gif->file);
+    fwrite(tama_gif_palette, 1, sizeof(tama_gif_palette), gif->file);
+
+    // Loop forever
+    fwrite("\x21\xFF\x0BNETSCAPE2.0\x03\x01\x00\x00\x00", 1, 19, gif->file);
+}
+
+static void tama_gif_frame(TamaGif* gif, uint16_t delay) {
+    fwrite("\x21\xF9\x04\x00", 1, 4, gif->file);
+    tama_gif_u16(gif->file, delay);
+    fputc(0, gif->file);
+    fputc(0, gif->file);
+
+    fputc(0x2C, gif->file);
+    tama_gif_u16(gif->file, 0);
+    tama_gif_u16(gif->file, 0);
+    tama_gif_u16(gif->file, gif->width);
+    tama_gif_u16(gif->file, gif->height);
+    fputc(0, gif->file);
+    tama_gif_lzw(gif);
+    gif->frames++;
+}
+
+static void tama_gif_fill(TamaGif* gif, uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+    for(uint16_t row = y; row < y + h; row++)
+        memset(&gif->pixels[(size_t)row * gif->width + x], 1, w);
+}
+
+static void tama_gif_render(
+    TamaGif* gif,
+    uint16_t scale,
+    const uint32_t framebuffer[16],
+    uint8_t icons) {
+    // Icons are drawn as blocks in slots a quarter of the matrix wide
+    uint16_t slot = 8 * scale;
+    uint16_t icon = 4 * scale;
+
+    memset(gif->pixels, 0, (size_t)gif->width * gif->height);
+    for(uint8_t i = 0; i < 8; i++) {
+        if(!(icons & (1 << i))) continue;
+        uint16_t x = (i % 4) * slot + (slot - icon) / 2;
+        uint16_t y = i < 4 ? scale : gif->height - scale - icon;
+        tama_gif_fill(gif, x, y, icon, icon);
+    }
+
+    uint16_t top = icon + 2 * scale;
+    for(uint8_t row = 0; row < 16; row++) {
+        for(uint8_t col = 0; col < 32; col++) {
+            if(framebuffer[row] & (1UL << col))
+                tama_gif_fill(gif, col * scale, top + row * scale, scale, scale);
+        }
+    }
+}
+
+static uint64_t tama_gif_centis(uint64_t ticks) {
+    return (ticks * 100 + TICK_FREQUENCY / 2) / TICK_FREQUENCY;
+}
+
+static void tama_gif_usage(const char* name) {
+    fprintf(stderr, "Usage: %s [-s scale] in.tcap out.gif\n", name);
+    fprintf(stderr, "  -s  pixels per LCD dot (default %d)\n", TAMA_GIF_DEFAULT_SCALE);
+}
+
+int main(int argc, char** argv) {
+    uint16_t scale = TAMA_GIF_DEFAULT_SCALE;
+    int opt;
+
+    while((opt = getopt(argc, argv, "s:h")) != -1) {
+        switch(opt) {
+        case 's':
+            scale = strtoul(optarg, NULL, 0);
+            break;
+        case 'h':
+            tama_gif_usage(argv[0]);
+            return 0;
+        default:
+            tama_gif_usage(argv[0]);
+            return 1;
+        }
+    }
+    if(optind != argc - 2 || scale == 0 || scale > 64) {
+        tama_gif_usage(argv[0]);
+        return 1;
+    }
+
+    FILE* in = fopen(argv[optind], "rb");
+    if(in == NULL) {
+        fprintf(stderr, "Cannot open \"%s\"\n", argv[optind]);
+        return 1;
+    }
+    uint8_t buf[TAMA_CAPTURE_FRAME_MAX];
+    size_t len = fread(buf, 1, TAMA_CAPTURE_HEADER_SIZE, in);
+    if(!tama_capture_header_check(buf, len)) {
+        fprintf(stderr, "\"%s\" is not a screen capture\n", argv[optind]);
+        fclose(in);
+        return 1;
+    }
+
+    static TamaGif gif;
+    gif.width = 32 * scale;
+    gif.height = 16 * scale + 2 * (4 * scale + 2 * scale);
+    gif.pixels = malloc((size_t)gif.width * gif.height);
+    gif.file = fopen(argv[optind + 1], "wb");
+    if(gif.file == NULL) {
+        fprintf(stderr, "Cannot create \"%s\"\n", argv[optind + 1]);
+        fclose(in);
+        free(gif.pixels);
+        return 1;
+    }
+    tama_gif_begin(&gif);
+
+    // A frame is written once the next one tells how long it stayed up.
+    // Delays are rounded on the absolute timeline so they don't drift, and a
+    // frame that rounds to no time at all is replaced by the next.
+    uint32_t framebuffer[16] = {0};
+    uint8_t icons = 0;
+    uint64_t ticks = 0;
+    uint64_t shown = 0;
+    bool pending = false;
+    len = 0;
+    while(true) {
+        len += fread(&buf[len], 1, sizeof(buf) - len, in);
+        uint32_t delta;
+        uint32_t next_framebuffer[16];
+        uint8_t next_icons;
+        memcpy(next_framebuffer, framebuffer, sizeof(framebuffer));
+        size_t used = tama_capture_frame_decode(buf, len, &delta, next_framebuffer, &next_icons);
+        if(used == 0) break;
+        memmove(buf, &buf[used], len - used);
+        len -= used;
+
+        ticks += delta;
+        uint64_t delay = tama_gif_centis(ticks) - shown;
+        if(delay > UINT16_MAX) delay = UINT16_MAX;
+        if(pending && delay > 0) {
+            tama_gif_render(&gif, scale, framebuffer, icons);
+            tama_gif_frame(&gif, delay);
+            shown += delay;
+        }
+        memcpy(framebuffer, next_framebuffer, sizeof(framebuffer));
+        icons = next_icons;
+        pending = true;
+    }
+    if(pending) {
+        tama_gif_render(&gif, scale, framebuffer, icons);
+        tama_gif_frame(&gif, TAMA_GIF_LAST_DELAY);
+    }
+    if(len > 0) fprintf(stderr, "Capture ends in the middle of a frame\n");
+
+    fputc(0x3B, gif.file);
+    fclose(gif.file);
+    fclose(in);
+    free(gif.pixels);
+
+    printf("%u frames, %.1f s\n", gif.frames, (double)ticks / TICK_FREQUENCY);
+    return 0;
+}
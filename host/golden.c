@@ -0,0 +1,82 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "tama_host.h"
+
+/*
+ * Golden files are plain text, one "<tick> <hash>" line per emulated second,
+ * where tick is the CPU tick the frame hash was taken at.
+ */
+
+bool tama_host_golden_open(const char* path, bool write) {
+    TamaHostGolden* golden = &g_host.golden;
+
+    golden->file = fopen(path, write ? "w" : "r");
+    if(golden->file == NULL) {
+        fprintf(stderr, "Cannot open \"%s\"\n", path);
+        return false;
+    }
+
+    golden->write = write;
+    golden->next_tick = TICK_FREQUENCY;
+    golden->samples = 0;
+    golden->diverged = false;
+    return true;
+}
+
+void tama_host_golden_sample(uint64_t ticks) {
+    TamaHostGolden* golden = &g_host.golden;
+    uint32_t hash = tama_host_frame_hash();
+
+    golden->next_tick += TICK_FREQUENCY;
+    golden->samples++;
+
+    if(golden->write) {
+        fprintf(golden->file, "%" PRIu64 " %08x\n", ticks, hash);
+        return;
+    }
+
+    uint64_t expected_ticks;
+    uint32_t expected_hash;
+    if(fscanf(golden->file, "%" SCNu64 " %x", &expected_ticks, &expected_hash) != 2) {
+        fprintf(stderr, "Golden file ends before tick %" PRIu64 "\n", ticks);
+        golden->diverged = true;
+    } else if(expected_ticks != ticks || expected_hash != hash) {
+        fprintf(
+            stderr,
+            "First divergence at second %u: expected %08x at tick %" PRIu64
+            ", got %08x at tick %" PRIu64 "\n",
+            golden->samples,
+            expected_hash,
+            expected_ticks,
+            hash,
+            ticks);
+        golden->diverged = true;
+    }
+
+    if(golden->diverged) golden->divergent_tick = ticks;
+}
+
+void tama_host_golden_finish(uint64_t ticks) {
+    TamaHostGolden* golden = &g_host.golden;
+    uint64_t expected_ticks;
+    uint32_t expected_hash;
+
+    if(golden->file == NULL || golden->write || golden->diverged) return;
+    if(fscanf(golden->file, "%" SCNu64 " %x", &expected_ticks, &expected_hash) != 2) return;
+
+    fprintf(
+        stderr,
+        "Run ends at tick %" PRIu64 ", golden file goes on to tick %" PRIu64 "\n",
+        ticks,
+        expected_ticks);
+    golden->diverged = true;
+    golden->divergent_tick = ticks;
+}
+
+void tama_host_golden_close(void) {
+    TamaHostGolden* golden = &g_host.golden;
+
+    if(golden->file != NULL) fclose(golden->file);
+    golden->file = NULL;
+}
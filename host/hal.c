@@ -0,0 +1,147 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "tama_host.h"
+
+static void* tama_host_hal_malloc(u32_t size) {
+    return malloc(size);
+}
+
+static void tama_host_hal_free(void* ptr) {
+    free(ptr);
+}
+
+static void tama_host_hal_halt(void) {
+    g_host.halted = true;
+    g_host.next_event = *tamalib_get_state()->tick_counter;
+}
+
+static bool_t tama_host_hal_is_log_enabled(log_level_t level) {
+#if defined(TAMA_PROFILE_RELEASE)
+    return false;
+#elif defined(TAMA_PROFILE_DIAG)
+    return true;
+#else
+    return level == LOG_ERROR || level == LOG_INFO;
+#endif
+}
+
+static void tama_host_hal_log(log_level_t level, char* buff, ...) {
+    if(!tama_host_hal_is_log_enabled(level)) return;
+#ifdef TAMA_PROFILE_DIAG
+    g_host.diag.logs++;
+#endif
+
+    va_list args;
+    va_start(args, buff);
+    vfprintf(stderr, buff, args);
+    va_end(args);
+}
+
+static void tama_host_hal_sleep_until(timestamp_t ts) {
+    // Runs unthrottled, nothing to wait for
+}
+
+static timestamp_t tama_host_hal_get_timestamp(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (timestamp_t)(now.tv_sec * 1000000ULL + now.tv_nsec / 1000);
+}
+
+static void tama_host_hal_update_screen(void) {
+}
+
+#ifdef TAMA_LCD_LAZY
+static void tama_host_hal_set_lcd_matrix(u8_t x, u8_t y, bool_t val) {
+#ifdef TAMA_PROFILE_DIAG
+    g_host.diag.lcd_matrix++;
+#endif
+    g_host.lcd_dirty = true;
+}
+
+static void tama_host_hal_set_lcd_icon(u8_t icon, bool_t val) {
+#ifdef TAMA_PROFILE_DIAG
+    g_host.diag.lcd_icon++;
+#endif
+    g_host.lcd_dirty = true;
+}
+#else
+static void tama_host_hal_set_lcd_matrix(u8_t x, u8_t y, bool_t val) {
+#ifdef TAMA_PROFILE_DIAG
+    g_host.diag.lcd_matrix++;
+#endif
+    if(val)
+        g_host.framebuffer[y] |= 1UL << x;
+    else
+        g_host.framebuffer[y] &= ~(1UL << x);
+}
+
+static void tama_host_hal_set_lcd_icon(u8_t icon, bool_t val) {
+#ifdef TAMA_PROFILE_DIAG
+    g_host.diag.lcd_icon++;
+#endif
+    if(val)
+        g_host.icons |= 1 << icon;
+    else
+        g_host.icons &= ~(1 << icon);
+}
+#endif
+
+void tama_host_lcd_sync(void) {
+#ifdef TAMA_LCD_LAZY
+    if(!g_host.lcd_dirty) return;
+    g_host.lcd_dirty = false;
+    tama_lcd_decode(tamalib_get_state()->memory, g_host.framebuffer, &g_host.icons);
+#endif
+}
+
+static void tama_host_hal_buzzer_post(const TamaBuzzerEvent* event) {
+    if(g_host.wav != NULL) tama_wav_event(g_host.wav, tama_host_ticks(), event->frequency);
+}
+
+static void tama_host_hal_play_frequency(bool_t en) {
+    TamaBuzzerEvent event;
+#ifdef TAMA_PROFILE_DIAG
+    g_host.diag.play_frequency++;
+#endif
+    if(tama_buzzer_play(&g_host.buzzer, en, *tamalib_get_state()->tick_counter, &event))
+        tama_host_hal_buzzer_post(&event);
+}
+
+static void tama_host_hal_set_frequency(u32_t freq) {
+    TamaBuzzerEvent event;
+#ifdef TAMA_PROFILE_DIAG
+    g_host.diag.set_frequency++;
+#endif
+    if(tama_buzzer_set_frequency(
+           &g_host.buzzer, freq, *tamalib_get_state()->tick_counter, &event))
+        tama_host_hal_buzzer_post(&event);
+}
+
+static int tama_host_hal_handler(void) {
+    return 0;
+}
+
+uint64_t tama_host_ticks(void) {
+    uint32_t tick = *tamalib_get_state()->tick_counter;
+    g_host.ticks += (uint32_t)(tick - g_host.last_tick);
+    g_host.last_tick = tick;
+    return g_host.ticks;
+}
+
+void tama_host_hal_init(hal_t* hal) {
+    hal->malloc = tama_host_hal_malloc;
+    hal->free = tama_host_hal_free;
+    hal->halt = tama_host_hal_halt;
+    hal->is_log_enabled = tama_host_hal_is_log_enabled;
+    hal->log = tama_host_hal_log;
+    hal->sleep_until = tama_host_hal_sleep_until;
+    hal->get_timestamp = tama_host_hal_get_timestamp;
+    hal->update_screen = tama_host_hal_update_screen;
+    hal->set_lcd_matrix = tama_host_hal_set_lcd_matrix;
+    hal->set_lcd_icon = tama_host_hal_set_lcd_icon;
+    hal->set_frequency = tama_host_hal_set_frequency;
+    hal->play_frequency = tama_host_hal_play_frequency;
+    hal->handler = tama_host_hal_handler;
+}
@@ -0,0 +1,322 @@
+/*
+ * Lockstep differential tester. Runs two tama_host builds, e.g. one against
+ * the reference TamaLIB and one against an optimized core, on the same ROM
+ * and arguments and compares their CPU state (registers, interrupts, RAM and
+ * I/O) every period CPU ticks. Step counts are only reported, since a faster
+ * core may take fewer steps for the same time. TamaLIB keeps its state in
+ * statics, so each build runs in its own process and streams its trace (see
+ * trace.c) through a pipe. At the first mismatch both are run again from the last matching
+ * record with a period of 1, to find the instruction after which they differ.
+ *
+ *   tama_lockstep [-p ticks] ref_runner test_runner [runner args] rom.bin
+ *
+ * Exits with 0 when the runs agree to the end, 2 when they diverge.
+ */
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "tama_host.h"
+
+#define TAMA_LOCKSTEP_TRACE_FD  3
+#define TAMA_LOCKSTEP_DIFFS_MAX 32
+
+typedef struct {
+    pid_t pid;
+    FILE* trace;
+} TamaLockstepRunner;
+
+typedef enum {
+    TamaLockstepAgreed,
+    TamaLockstepDiverged,
+    TamaLockstepEnded, // One side stopped sending records before the other
+    TamaLockstepFailed,
+} TamaLockstepStatus;
+
+static uint64_t tama_lockstep_get64(const uint8_t* buf) {
+    uint64_t value = 0;
+    for(size_t i = 0; i < 8; i++) value |= (uint64_t)buf[i] << (i * 8);
+    return value;
+}
+
+static bool tama_lockstep_spawn(
+    TamaLockstepRunner* runner,
+    const char* path,
+    char** args,
+    int arg_count,
+    uint64_t period,
+    uint64_t start) {
+    char spec[48];
+    int fds[2];
+
+    snprintf(
+        spec, sizeof(spec), "%llu,%llu", (unsigned long long)period, (unsigned long long)start);
+    if(pipe(fds)) {
+        perror("pipe");
+        return false;
+    }
+
+    runner->pid = fork();
+    if(runner->pid < 0) {
+        perror("fork");
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+
+    if(runner->pid == 0) {
+        // The trace goes to fd 3, the runner's own report nowhere
+        char* argv[arg_count + 6];
+        int null = open("/dev/null", O_WRONLY);
+
+        if(fds[0] != TAMA_LOCKSTEP_TRACE_FD) close(fds[0]);
+        if(fds[1] != TAMA_LOCKSTEP_TRACE_FD) {
+            dup2(fds[1], TAMA_LOCKSTEP_TRACE_FD);
+            close(fds[1]);
+        }
+        if(null >= 0) dup2(null, STDOUT_FILENO);
+
+        argv[0] = (char*)path;
+        argv[1] = "-l";
+        argv[2] = "/dev/fd/3";
+        argv[3] = "-L";
+        argv[4] = spec;
+        memcpy(&argv[5], args, arg_count * sizeof(char*));
+        argv[arg_count + 5] = NULL;
+        execv(path, argv);
+        fprintf(stderr, "Cannot run \"%s\"\n", path);
+        _exit(127);
+    }
+
+    close(fds[1]);
+    runner->trace = fdopen(fds[0], "rb");
+    return true;
+}
+
+// Reaps the runner, true if it ran to the end without error
+static bool tama_lockstep_reap(TamaLockstepRunner* runner, bool kill_it) {
+    int status = 0;
+
+    if(runner->trace != NULL) fclose(runner->trace);
+    runner->trace = NULL;
+    if(runner->pid <= 0) return false;
+    if(kill_it) kill(runner->pid, SIGKILL);
+    waitpid(runner->pid, &status, 0);
+    runner->pid = 0;
+    // 2 is a golden divergence, which the other side then has to agree on
+    return WIFEXITED(status) && (WEXITSTATUS(status) == 0 || WEXITSTATUS(status) == 2);
+}
+
+static void tama_lockstep_print_diff(
+    const char* name,
+    int32_t index,
+    uint32_t a,
+    uint32_t b,
+    void* context) {
+    size_t* printed = context;
+
+    if((*printed)++ >= TAMA_LOCKSTEP_DIFFS_MAX) return;
+    if(index < 0) {
+        printf("  %-14s %x != %x\n", name, a, b);
+    } else if(!strcmp(name, "ram") || !strcmp(name, "io")) {
+        printf("  %-3s %03x        %x != %x\n", name, index, a, b);
+    } else {
+        printf("  %-10s [%d] %x != %x\n", name, index, a, b);
+    }
+}
+
+// The pc register leads the save file format, after the 5 byte header
+static uint16_t tama_lockstep_pc(const uint8_t* record) {
+    return record[16 + 5] | record[16 + 6] << 8;
+}
+
+static void tama_lockstep_report(const uint8_t* last, const uint8_t* ref, const uint8_t* test) {
+    size_t printed = 0;
+
+    printf(
+        "Diverged at tick %llu, step %llu (test: tick %llu, step %llu)\n",
+        (unsigned long long)tama_lockstep_get64(ref),
+        (unsigned long long)tama_lockstep_get64(ref + 8),
+        (unsigned long long)tama_lockstep_get64(test),
+        (unsigned long long)tama_lockstep_get64(test + 8));
+    if(last != NULL) printf("  after the instruction at pc %04x\n", tama_lockstep_pc(last));
+    printf("  %-14s ref != test\n", "field");
+
+    size_t diffs = tama_state_diff(ref + 16, test + 16, tama_lockstep_print_diff, &printed);
+    if(diffs > TAMA_LOCKSTEP_DIFFS_MAX)
+        printf("  ... %zu more\n", diffs - TAMA_LOCKSTEP_DIFFS_MAX);
+}
+
+/*
+ * Runs both sides from start and compares the CPU state of their records. On a
+ * mismatch the records are left in ref and test, and last holds the last
+ * matching record of the reference if valid was set, test_steps the step
+ * count of the test side at that record.
+ */
+static TamaLockstepStatus tama_lockstep_compare(
+    const char* ref_path,
+    const char* test_path,
+    char** args,
+    int arg_count,
+    uint64_t period,
+    uint64_t start,
+    uint8_t* last,
+    bool* valid,
+    uint8_t* ref,
+    uint8_t* test,
+    uint64_t* records,
+    uint64_t* test_steps) {
+    TamaLockstepRunner ref_runner = {0};
+    TamaLockstepRunner test_runner = {0};
+    TamaLockstepStatus status = TamaLockstepAgreed;
+
+    if(!tama_lockstep_spawn(&ref_runner, ref_path, args, arg_count, period, start) ||
+       !tama_lockstep_spawn(&test_runner, test_path, args, arg_count, period, start)) {
+        tama_lockstep_reap(&ref_runner, true);
+        return TamaLockstepFailed;
+    }
+
+    *valid = false;
+    *records = 0;
+    while(true) {
+        bool got_ref = fread(ref, 1, TAMA_TRACE_RECORD_SIZE, ref_runner.trace) ==
+                       TAMA_TRACE_RECORD_SIZE;
+        bool got_test = fread(test, 1, TAMA_TRACE_RECORD_SIZE, test_runner.trace) ==
+                        TAMA_TRACE_RECORD_SIZE;
+        if(!got_ref && !got_test) break;
+        if(got_ref != got_test) {
+            printf(
+                "%s run ended after %llu records\n",
+                got_ref ? "Test" : "Reference",
+                (unsigned long long)*records);
+            status = TamaLockstepEnded;
+            break;
+        }
+        // Past the tick and step counts
+        if(memcmp(ref + 16, test + 16, TAMA_TRACE_RECORD_SIZE - 16)) {
+            status = TamaLockstepDiverged;
+            break;
+        }
+        memcpy(last, ref, TAMA_TRACE_RECORD_SIZE);
+        *test_steps = tama_lockstep_get64(test + 8);
+        *valid = true;
+        (*records)++;
+    }
+
+    bool kill_them = status != TamaLockstepAgreed;
+    bool ref_ok = tama_lockstep_reap(&ref_runner, kill_them);
+    bool test_ok = tama_lockstep_reap(&test_runner, kill_them);
+    if(!kill_them && (!ref_ok || !test_ok)) {
+        fprintf(stderr, "%s runner failed\n", ref_ok ? "Test" : "Reference");
+        return TamaLockstepFailed;
+    }
+    return status;
+}
+
+static void tama_lockstep_usage(const char* name) {
+    fprintf(stderr, "Usage: %s [-p ticks] ref_runner test_runner [runner args] rom.bin\n", name);
+    fprintf(
+        stderr, "  -p  CPU ticks between compares (default %u, one second)\n", TICK_FREQUENCY);
+}
+
+int main(int argc, char** argv) {
+    uint64_t period = TICK_FREQUENCY;
+    int opt;
+
+    // Stop at the first non-option, the rest belongs to the runners
+    while((opt = getopt(argc, argv, "+p:h")) != -1) {
+        switch(opt) {
+        case 'p':
+            period = strtoull(optarg, NULL, 0);
+            break;
+        case 'h':
+            tama_lockstep_usage(argv[0]);
+            return 0;
+        default:
+            tama_lockstep_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if(argc - optind < 3 || period == 0) {
+        tama_lockstep_usage(argv[0]);
+        return 1;
+    }
+
+    // A runner killed mid-write must not take us with it
+    signal(SIGPIPE, SIG_IGN);
+
+    const char* ref_path = argv[optind];
+    const char* test_path = argv[optind + 1];
+    char** args = &argv[optind + 2];
+    int arg_count = argc - optind - 2;
+    static uint8_t last[TAMA_TRACE_RECORD_SIZE];
+    static uint8_t ref[TAMA_TRACE_RECORD_SIZE];
+    static uint8_t test[TAMA_TRACE_RECORD_SIZE];
+    uint64_t records;
+    uint64_t test_steps = 0;
+    bool valid;
+
+    TamaLockstepStatus status = tama_lockstep_compare(
+        ref_path,
+        test_path,
+        args,
+        arg_count,
+        period,
+        0,
+        last,
+        &valid,
+        ref,
+        test,
+        &records,
+        &test_steps);
+    if(status == TamaLockstepAgreed) {
+        printf(
+            "Agreed on %llu records, every %llu ticks\n",
+            (unsigned long long)records,
+            (unsigned long long)period);
+        if(valid)
+            printf(
+                "  steps: ref %llu, test %llu\n",
+                (unsigned long long)tama_lockstep_get64(last + 8),
+                (unsigned long long)test_steps);
+        return 0;
+    }
+    if(status == TamaLockstepFailed) return 1;
+
+    if(period > 1) {
+        // Narrow it down to one instruction from the last point both agreed on
+        uint64_t start = valid ? tama_lockstep_get64(last) : 0;
+        printf(
+            "Mismatch within %llu ticks of tick %llu, stepping\n",
+            (unsigned long long)period,
+            (unsigned long long)start);
+        status = tama_lockstep_compare(
+            ref_path,
+            test_path,
+            args,
+            arg_count,
+            1,
+            start,
+            last,
+            &valid,
+            ref,
+            test,
+            &records,
+            &test_steps);
+        if(status == TamaLockstepFailed) return 1;
+    }
+
+    if(status == TamaLockstepDiverged) {
+        tama_lockstep_report(valid ? last : NULL, ref, test);
+    } else if(status == TamaLockstepEnded) {
+        if(valid) printf("  last agreed at pc %04x\n", tama_lockstep_pc(last));
+    } else {
+        // Only the sampled runs differed, e.g. a deadline that moved with the period
+        printf("Stepped run agreed, the mismatch did not reproduce\n");
+    }
+    return 2;
+}
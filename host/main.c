@@ -0,0 +1,47 @@
+/*
+ * Headless TamaLIB runner. Runs a ROM unthrottled for a fixed emulated
+ * duration, for testing and profiling away from the device.
+ */
+#include <stdio.h>
+#include "tama_host.h"
+
+int main(int argc, char** argv) {
+    TamaHostJob job;
+    TamaHostResult result;
+
+    int parsed = tama_host_parse_args(argc, argv, &job);
+    if(parsed <= 0) {
+        tama_host_usage(argv[0]);
+        return parsed == 0 ? 0 : 1;
+    }
+
+    if(!tama_host_run(&job, &result)) return 1;
+
+    printf(
+        "%.1f emulated s in %.3f s (%.0fx), %llu steps, %.1f Msteps/s%s\n",
+        (double)result.ticks / TICK_FREQUENCY,
+        result.elapsed,
+        result.elapsed > 0 ? (double)result.ticks / TICK_FREQUENCY / result.elapsed : 0,
+        (unsigned long long)result.steps,
+        result.elapsed > 0 ? result.steps / result.elapsed / 1e6 : 0,
+        result.halted ? ", halted" : "");
+    if(job.movie_path != NULL) printf("Replayed %u input events\n", result.movie_events);
+    if(job.script_path != NULL)
+        printf("Script fired %u times, %u presses\n", result.script_fired, result.script_presses);
+    printf("Final frame hash %08x\n", result.hash);
+#ifdef TAMA_PROFILE_DIAG
+    printf(
+        "HAL calls: %llu pixels, %llu icons, %llu frequency, %llu play, %llu logs\n",
+        (unsigned long long)result.diag.lcd_matrix,
+        (unsigned long long)result.diag.lcd_icon,
+        (unsigned long long)result.diag.set_frequency,
+        (unsigned long long)result.diag.play_frequency,
+        (unsigned long long)result.diag.logs);
+#endif
+    if(result.diverged) {
+        printf("Diverged from golden at tick %llu\n", (unsigned long long)result.divergent_tick);
+        return 2;
+    }
+
+    return 0;
+}
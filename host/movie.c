@@ -0,0 +1,49 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "tama_host.h"
+
+static bool tama_host_movie_next(TamaHostMovie* movie) {
+    if(movie->size - movie->pos < TAMA_MOVIE_EVENT_SIZE) return false;
+
+    tama_movie_event_decode(&movie->data[movie->pos], &movie->next);
+    movie->pos += TAMA_MOVIE_EVENT_SIZE;
+    return true;
+}
+
+bool tama_host_movie_load(uint8_t* data, size_t size) {
+    TamaHostMovie* movie = &g_host.movie;
+
+    if(!tama_movie_header_load(data, size)) return false;
+
+    movie->data = data;
+    movie->size = size;
+    movie->pos = TAMA_MOVIE_HEADER_SIZE;
+    movie->last_tick = *tamalib_get_state()->tick_counter;
+    movie->events = 0;
+    movie->active = tama_host_movie_next(movie);
+    return movie->active;
+}
+
+void tama_host_movie_step(void) {
+    TamaHostMovie* movie = &g_host.movie;
+    uint32_t tick = *tamalib_get_state()->tick_counter;
+
+    // Same injection rule as the device replay, see tama_p1_movie_replay_step
+    while((uint32_t)(tick - movie->last_tick) >= movie->next.delta) {
+        movie->last_tick += movie->next.delta;
+        if(movie->next.button == TAMA_MOVIE_END) {
+            movie->active = false;
+            return;
+        }
+
+        tamalib_set_button(
+            movie->next.button, movie->next.pressed ? BTN_STATE_PRESSED : BTN_STATE_RELEASED);
+        movie->events++;
+
+        if(!tama_host_movie_next(movie)) {
+            fprintf(stderr, "Movie ended without end marker\n");
+            movie->active = false;
+            return;
+        }
+    }
+}
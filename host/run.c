@@ -0,0 +1,353 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "tama_host.h"
+
+TamaHost g_host;
+
+#ifdef TAMA_DEBUGGER
+#define TAMA_HOST_OPTIONS "t:s:m:w:g:G:c:r:l:L:dh"
+#else
+#define TAMA_HOST_OPTIONS "t:s:m:w:g:G:c:r:l:L:h"
+#endif
+
+void tama_host_usage(const char* name) {
+    fprintf(
+        stderr,
+        "Usage: %s [-t seconds] [-s state.sav] [-m input.mov] [-w out.wav] [-g|-G golden.txt] "
+        "[-c out.tcap] [-r rules.txt] [-l out.trace] [-L period[,start]]%s rom.bin\n",
+        name,
+#ifdef TAMA_DEBUGGER
+        " [-d]");
+#else
+        "");
+#endif
+    fprintf(stderr, "  -t  emulated seconds to run (default %d)\n", TAMA_HOST_DEFAULT_SECONDS);
+    fprintf(stderr, "  -s  start from a saved state\n");
+    fprintf(stderr, "  -m  replay an input movie, until its end unless -t is given\n");
+    fprintf(stderr, "  -w  render the buzzer to a WAV file\n");
+    fprintf(stderr, "  -g  check the frame hash of every emulated second against a golden file\n");
+    fprintf(stderr, "  -G  record a golden file\n");
+    fprintf(stderr, "  -c  capture the LCD for tama_gif\n");
+    fprintf(stderr, "  -r  play by the rules in a script, see script.c\n");
+    fprintf(stderr, "  -l  write a lockstep trace for tama_lockstep, see trace.c\n");
+    fprintf(stderr, "  -L  CPU ticks between trace records (one second) and of the first one\n");
+#ifdef TAMA_DEBUGGER
+    fprintf(stderr, "  -d  start at the debugger prompt, see debug.c\n");
+#endif
+}
+
+int tama_host_parse_args(int argc, char** argv, TamaHostJob* job) {
+    int opt;
+
+    memset(job, 0, sizeof(TamaHostJob));
+    optind = 1;
+    while((opt = getopt(argc, argv, TAMA_HOST_OPTIONS)) != -1) {
+        switch(opt) {
+        case 't':
+            job->seconds = strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            job->state_path = optarg;
+            break;
+        case 'm':
+            job->movie_path = optarg;
+            break;
+        case 'w':
+            job->wav_path = optarg;
+            break;
+        case 'g':
+        case 'G':
+            job->golden_path = optarg;
+            job->golden_write = opt == 'G';
+            break;
+        case 'c':
+            job->capture_path = optarg;
+            break;
+        case 'r':
+            job->script_path = optarg;
+            break;
+        case 'l':
+            job->trace_path = optarg;
+            break;
+        case 'L': {
+            char* rest;
+            job->trace_period = strtoull(optarg, &rest, 0);
+            if(*rest == ',') job->trace_start = strtoull(rest + 1, NULL, 0);
+            break;
+        }
+        case 'd':
+            job->debug = true;
+            break;
+        case 'h':
+            return 0;
+        default:
+            return -1;
+        }
+    }
+
+    if(optind != argc - 1) return -1;
+    job->rom_path = argv[optind];
+    return 1;
+}
+
+static uint8_t* tama_host_read_file(const char* path, size_t* size) {
+    FILE* file = fopen(path, "rb");
+    if(file == NULL) {
+        fprintf(stderr, "Cannot open \"%s\"\n", path);
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long len = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    uint8_t* data = malloc(len > 0 ? (size_t)len : 1);
+    *size = fread(data, 1, len > 0 ? (size_t)len : 0, file);
+    fclose(file);
+    if(len < 0 || *size != (size_t)len) {
+        fprintf(stderr, "Short read from \"%s\"\n", path);
+        free(data);
+        return NULL;
+    }
+
+    return data;
+}
+
+static bool tama_host_load_rom(const char* path) {
+    g_host.rom = tama_host_read_file(path, &g_host.rom_size);
+    if(g_host.rom == NULL) return false;
+    if(g_host.rom_size == 0 || g_host.rom_size % 2) {
+        fprintf(stderr, "Bad ROM size %zu\n", g_host.rom_size);
+        return false;
+    }
+
+    // Reorder endianess of ROM, as on the device
+    for(size_t i = 0; i < g_host.rom_size; i += 2) {
+        uint8_t b = g_host.rom[i];
+        g_host.rom[i] = g_host.rom[i + 1];
+        g_host.rom[i + 1] = b & 0xF;
+    }
+
+    return true;
+}
+
+static bool tama_host_load_state(const char* path) {
+    size_t size;
+    uint8_t* data = tama_host_read_file(path, &size);
+    if(data == NULL) return false;
+
+    bool loaded = tama_state_load(data, size);
+    free(data);
+    if(!loaded) fprintf(stderr, "Wrong state file magic, version or size in \"%s\"\n", path);
+    return loaded;
+}
+
+static bool tama_host_load_movie(const char* path) {
+    size_t size;
+    uint8_t* data = tama_host_read_file(path, &size);
+    if(data == NULL) return false;
+
+    if(!tama_host_movie_load(data, size)) {
+        fprintf(stderr, "Invalid movie \"%s\"\n", path);
+        free(data);
+        return false;
+    }
+    return true;
+}
+
+// Folds every deadline of the run loop into one TamaLIB tick, with ticks at hand
+static uint32_t tama_host_next_event(uint64_t ticks, uint64_t end) {
+    uint64_t next = end != 0 ? end : UINT64_MAX;
+    if(g_host.golden.next_tick < next) next = g_host.golden.next_tick;
+    if(g_host.capture.next_tick < next) next = g_host.capture.next_tick;
+    if(g_host.trace.next_tick < next) next = g_host.trace.next_tick;
+    if(g_host.batch.next_tick < next) next = g_host.batch.next_tick;
+    if(g_host.movie.active) {
+        // Not due yet, or tama_host_movie_step would have injected it
+        TamaHostMovie* movie = &g_host.movie;
+        uint32_t due = movie->next.delta - (g_host.last_tick - movie->last_tick);
+        if(ticks + due < next) next = ticks + due;
+    }
+
+    // Keep far deadlines within reach of the signed compare in the loop
+    if(next - ticks > INT32_MAX) next = ticks + INT32_MAX;
+    return g_host.last_tick + (uint32_t)(next - ticks);
+}
+
+static double tama_host_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+void tama_host_batch_set(uint64_t period, TamaHostBatchCallback callback, void* context) {
+    TamaHostBatch* batch = &g_host.batch;
+
+    batch->period = period;
+    batch->callback = period ? callback : NULL;
+    batch->context = context;
+    batch->next_tick = period ? g_host.ticks + period : UINT64_MAX;
+    batch->next_period = batch->next_tick;
+}
+
+void tama_host_batch_at(uint64_t tick) {
+    TamaHostBatch* batch = &g_host.batch;
+
+    if(batch->callback != NULL && tick < batch->next_tick) batch->next_tick = tick;
+}
+
+uint8_t tama_host_memory(uint16_t addr) {
+    const MEM_BUFFER_TYPE* memory = tamalib_get_state()->memory;
+
+    if(addr >= MEM_IO_ADDR && addr < MEM_IO_ADDR + MEM_IO_SIZE)
+        return GET_IO_MEMORY(memory, addr);
+    if(addr < MEM_RAM_ADDR + MEM_RAM_SIZE) return GET_RAM_MEMORY(memory, addr);
+    return 0;
+}
+
+uint32_t tama_host_frame_hash(void) {
+    // FNV-1a over the LCD rows, little endian, then the icons
+    uint32_t hash = 2166136261UL;
+    tama_host_lcd_sync();
+    for(size_t row = 0; row < 16; row++) {
+        for(size_t i = 0; i < 4; i++) {
+            hash ^= (g_host.framebuffer[row] >> (i * 8)) & 0xFF;
+            hash *= 16777619UL;
+        }
+    }
+    hash ^= g_host.icons;
+    hash *= 16777619UL;
+    return hash;
+}
+
+static void tama_host_release(void) {
+    if(g_host.wav != NULL) tama_wav_close(g_host.wav, g_host.ticks);
+    tama_host_golden_close();
+    tama_host_capture_close();
+    tama_host_trace_close();
+    free(g_host.movie.data);
+    free(g_host.rom);
+    memset(&g_host, 0, sizeof(TamaHost));
+}
+
+bool tama_host_run(const TamaHostJob* job, TamaHostResult* result) {
+    memset(result, 0, sizeof(TamaHostResult));
+    memset(&g_host, 0, sizeof(TamaHost));
+
+    if(!tama_host_load_rom(job->rom_path)) {
+        tama_host_release();
+        return false;
+    }
+
+    if(job->golden_path != NULL && !tama_host_golden_open(job->golden_path, job->golden_write)) {
+        tama_host_release();
+        return false;
+    }
+
+    if(job->capture_path != NULL && !tama_host_capture_open(job->capture_path)) {
+        tama_host_release();
+        return false;
+    }
+
+    if(job->trace_path != NULL &&
+       !tama_host_trace_open(job->trace_path, job->trace_period, job->trace_start)) {
+        tama_host_release();
+        return false;
+    }
+
+    if(job->wav_path != NULL) {
+        g_host.wav = tama_wav_open(job->wav_path);
+        if(g_host.wav == NULL) {
+            fprintf(stderr, "Cannot create \"%s\"\n", job->wav_path);
+            tama_host_release();
+            return false;
+        }
+    }
+
+    tama_host_hal_init(&g_host.hal);
+    tamalib_register_hal(&g_host.hal);
+    tamalib_init((u12_t*)g_host.rom, NULL, 1000000);
+    // 0 lets the core run as fast as the host allows
+    tamalib_set_speed(0);
+
+    g_host.batch.next_tick = UINT64_MAX;
+    if((job->state_path != NULL && !tama_host_load_state(job->state_path)) ||
+       (job->movie_path != NULL && !tama_host_load_movie(job->movie_path)) ||
+       (job->script_path != NULL && !tama_host_script_load(job->script_path))) {
+        tamalib_release();
+        tama_host_release();
+        return false;
+    }
+
+    uint32_t seconds = job->seconds;
+    if(seconds == 0 && job->movie_path == NULL) seconds = TAMA_HOST_DEFAULT_SECONDS;
+    g_host.last_tick = *tamalib_get_state()->tick_counter;
+
+    uint64_t end = (uint64_t)seconds * TICK_FREQUENCY;
+    // Without a golden file the sampling point is never reached
+    if(g_host.golden.file == NULL) g_host.golden.next_tick = UINT64_MAX;
+    if(g_host.capture.file == NULL) g_host.capture.next_tick = UINT64_MAX;
+    if(g_host.trace.file == NULL) g_host.trace.next_tick = UINT64_MAX;
+    const u32_t* tick_counter = tamalib_get_state()->tick_counter;
+    g_host.next_event = g_host.last_tick;
+    double start = tama_host_now();
+#ifdef TAMA_DEBUGGER
+    bool quit = job->debug && !tama_host_debug_prompt();
+#else
+    bool quit = false;
+#endif
+
+    while(!quit) {
+        // Nothing happens between two steps before the next deadline, so most
+        // steps cost a single compare here
+        if((int32_t)(*tick_counter - g_host.next_event) >= 0) {
+            uint64_t ticks = tama_host_ticks();
+            if(g_host.halted) break;
+            if(ticks >= g_host.golden.next_tick) {
+                tama_host_golden_sample(ticks);
+                if(g_host.golden.diverged) break;
+            }
+            if(ticks >= g_host.capture.next_tick) tama_host_capture_sample(ticks);
+            if(ticks >= g_host.trace.next_tick) tama_host_trace_sample(ticks, result->steps);
+            if(ticks >= g_host.batch.next_tick) {
+                // An early call from tama_host_batch_at keeps the period where it was
+                TamaHostBatch* batch = &g_host.batch;
+                if(ticks >= batch->next_period) batch->next_period += batch->period;
+                batch->next_tick = batch->next_period;
+                batch->callback(ticks, batch->context);
+            }
+            if(end != 0 && ticks >= end) break;
+            if(g_host.movie.active) {
+                tama_host_movie_step();
+                if(!g_host.movie.active && end == 0) break;
+            }
+            g_host.next_event = tama_host_next_event(ticks, end);
+        }
+        tamalib_step();
+        result->steps++;
+#ifdef TAMA_DEBUGGER
+        if(g_host.debug.armed && tama_host_debug_check()) quit = !tama_host_debug_prompt();
+#endif
+    }
+
+    result->elapsed = tama_host_now() - start;
+    tama_host_golden_finish(g_host.ticks);
+    result->ticks = g_host.ticks;
+    result->halted = g_host.halted;
+    result->movie_events = g_host.movie.events;
+    result->script_fired = g_host.script.fired;
+    result->script_presses = g_host.script.presses;
+    result->hash = tama_host_frame_hash();
+    result->diverged = g_host.golden.diverged;
+    result->divergent_tick = g_host.golden.divergent_tick;
+#ifdef TAMA_PROFILE_DIAG
+    result->diag = g_host.diag;
+#endif
+
+    tamalib_release();
+    tama_host_release();
+    return true;
+}
@@ -0,0 +1,264 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tama_host.h"
+
+/*
+ * Rule scripts for unattended play, one directive per line:
+ *
+ *   batch 100                   ms of emulated time between rule checks
+ *   hold 100                    ms a button is held down
+ *   gap 300                     ms between two button presses
+ *   when ram 0x040 < 2 and icon 0 do A B wait B cooldown 60
+ *
+ * Conditions: "ram <addr> <op> <value>" and "io <addr> <op> <value>" compare a
+ * memory nibble, "pixels <op> <value>" the lit LCD pixels, "icon <n>" and
+ * "noicon <n>" an icon, "blank" an empty LCD, "after <s>" the emulated time.
+ * Operators are == != < > <= >=. Actions are the buttons A, B, C and "wait"
+ * for one gap. Rules are checked in order at every batch once the previous
+ * sequence is done; the first match runs, then rests for its cooldown in
+ * emulated seconds. Holds and gaps are timed on their own, whatever the
+ * batch. # starts a comment.
+ */
+
+#define TAMA_SCRIPT_DEFAULT_BATCH_MS 100
+#define TAMA_SCRIPT_DEFAULT_HOLD_MS  100
+#define TAMA_SCRIPT_DEFAULT_GAP_MS   300
+#define TAMA_SCRIPT_WAIT             0xFF
+
+static uint64_t tama_script_ms(uint32_t ms) {
+    return (uint64_t)ms * TICK_FREQUENCY / 1000;
+}
+
+static bool tama_script_compare(uint32_t value, TamaScriptOp op, uint32_t operand) {
+    switch(op) {
+    case TamaScriptOpEq:
+        return value == operand;
+    case TamaScriptOpNe:
+        return value != operand;
+    case TamaScriptOpLt:
+        return value < operand;
+    case TamaScriptOpGt:
+        return value > operand;
+    case TamaScriptOpLe:
+        return value <= operand;
+    default:
+        return value >= operand;
+    }
+}
+
+static uint32_t tama_script_pixels(void) {
+    uint32_t pixels = 0;
+    for(size_t row = 0; row < 16; row++)
+        pixels += __builtin_popcount(g_host.framebuffer[row]);
+    return pixels;
+}
+
+static bool tama_script_check(const TamaScriptCond* cond, uint64_t ticks) {
+    switch(cond->type) {
+    case TamaScriptCondMemory:
+        return tama_script_compare(tama_host_memory(cond->arg), cond->op, cond->operand);
+    case TamaScriptCondPixels:
+        return tama_script_compare(tama_script_pixels(), cond->op, cond->operand);
+    case TamaScriptCondIcon:
+        return (g_host.icons >> cond->arg) & 1;
+    case TamaScriptCondNoIcon:
+        return !((g_host.icons >> cond->arg) & 1);
+    case TamaScriptCondBlank:
+        return tama_script_pixels() == 0;
+    default:
+        return ticks >= cond->operand * (uint64_t)TICK_FREQUENCY;
+    }
+}
+
+static void tama_script_batch(uint64_t ticks, void* context) {
+    TamaHostScript* script = context;
+
+    // Finish the running sequence first: press, hold, release, gap
+    if(script->action < script->action_count) {
+        if(ticks < script->next_tick) {
+            tama_host_batch_at(script->next_tick);
+            return;
+        }
+
+        uint8_t button = script->actions[script->action];
+        if(button == TAMA_SCRIPT_WAIT) {
+            script->action++;
+            script->next_tick = ticks + tama_script_ms(script->gap_ms);
+        } else if(!script->pressed) {
+            tamalib_set_button(button, BTN_STATE_PRESSED);
+            script->pressed = true;
+            script->presses++;
+            script->next_tick = ticks + tama_script_ms(script->hold_ms);
+        } else {
+            tamalib_set_button(button, BTN_STATE_RELEASED);
+            script->pressed = false;
+            script->action++;
+            script->next_tick = ticks + tama_script_ms(script->gap_ms);
+        }
+        // Hold and gap end on their own tick, not at the next batch
+        tama_host_batch_at(script->next_tick);
+        return;
+    }
+    if(ticks < script->next_tick) return;
+
+    tama_host_lcd_sync();
+    for(uint8_t i = 0; i < script->rule_count; i++) {
+        TamaScriptRule* rule = &script->rules[i];
+        if(ticks < rule->rest_until) continue;
+
+        bool match = true;
+        for(uint8_t c = 0; c < rule->cond_count && match; c++)
+            match = tama_script_check(&rule->conds[c], ticks);
+        if(!match) continue;
+
+        rule->fired++;
+        rule->rest_until = ticks + rule->cooldown * (uint64_t)TICK_FREQUENCY;
+        script->fired++;
+        memcpy(script->actions, rule->actions, rule->action_count);
+        script->action_count = rule->action_count;
+        script->action = 0;
+        script->next_tick = ticks;
+        tama_script_batch(ticks, context);
+        return;
+    }
+}
+
+static bool tama_script_number(const char* token, uint32_t* value) {
+    char* end;
+    if(token == NULL) return false;
+    *value = strtoul(token, &end, 0);
+    return *end == '\0';
+}
+
+static bool tama_script_op(const char* token, TamaScriptOp* op) {
+    static const char* const ops[] = {"==", "!=", "<", ">", "<=", ">="};
+    if(token == NULL) return false;
+    for(size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+        if(strcmp(token, ops[i]) == 0) {
+            *op = (TamaScriptOp)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool tama_script_parse_cond(char** save, const char* token, TamaScriptCond* cond) {
+    uint32_t arg;
+
+    if(strcmp(token, "ram") == 0 || strcmp(token, "io") == 0) {
+        bool io = token[0] == 'i';
+        cond->type = TamaScriptCondMemory;
+        if(!tama_script_number(strtok_r(NULL, " \t", save), &arg)) return false;
+        if(arg >= (io ? MEM_IO_SIZE : MEM_RAM_SIZE)) return false;
+        cond->arg = (io ? MEM_IO_ADDR : MEM_RAM_ADDR) + arg;
+        return tama_script_op(strtok_r(NULL, " \t", save), &cond->op) &&
+               tama_script_number(strtok_r(NULL, " \t", save), &cond->operand);
+    } else if(strcmp(token, "pixels") == 0) {
+        cond->type = TamaScriptCondPixels;
+        return tama_script_op(strtok_r(NULL, " \t", save), &cond->op) &&
+               tama_script_number(strtok_r(NULL, " \t", save), &cond->operand);
+    } else if(strcmp(token, "icon") == 0 || strcmp(token, "noicon") == 0) {
+        cond->type = token[0] == 'i' ? TamaScriptCondIcon : TamaScriptCondNoIcon;
+        if(!tama_script_number(strtok_r(NULL, " \t", save), &arg) || arg > 7) return false;
+        cond->arg = arg;
+        return true;
+    } else if(strcmp(token, "blank") == 0) {
+        cond->type = TamaScriptCondBlank;
+        return true;
+    } else if(strcmp(token, "after") == 0) {
+        cond->type = TamaScriptCondAfter;
+        return tama_script_number(strtok_r(NULL, " \t", save), &cond->operand);
+    }
+
+    return false;
+}
+
+static bool tama_script_parse_rule(char** save, TamaScriptRule* rule) {
+    char* token;
+
+    // Conditions joined by "and", up to "do"
+    while(true) {
+        token = strtok_r(NULL, " \t", save);
+        if(token == NULL || rule->cond_count == TAMA_SCRIPT_CONDS_MAX) return false;
+        if(!tama_script_parse_cond(save, token, &rule->conds[rule->cond_count++])) return false;
+
+        token = strtok_r(NULL, " \t", save);
+        if(token != NULL && strcmp(token, "do") == 0) break;
+        if(token == NULL || strcmp(token, "and") != 0) return false;
+    }
+
+    while((token = strtok_r(NULL, " \t", save)) != NULL) {
+        if(strcmp(token, "cooldown") == 0) {
+            return tama_script_number(strtok_r(NULL, " \t", save), &rule->cooldown) &&
+                   strtok_r(NULL, " \t", save) == NULL && rule->action_count > 0;
+        }
+        if(rule->action_count == TAMA_SCRIPT_ACTIONS_MAX) return false;
+
+        uint8_t action;
+        if(strcmp(token, "A") == 0)
+            action = BTN_LEFT;
+        else if(strcmp(token, "B") == 0)
+            action = BTN_MIDDLE;
+        else if(strcmp(token, "C") == 0)
+            action = BTN_RIGHT;
+        else if(strcmp(token, "wait") == 0)
+            action = TAMA_SCRIPT_WAIT;
+        else
+            return false;
+        rule->actions[rule->action_count++] = action;
+    }
+
+    return rule->action_count > 0;
+}
+
+bool tama_host_script_load(const char* path) {
+    TamaHostScript* script = &g_host.script;
+    char line[256];
+    int line_number = 0;
+
+    FILE* file = fopen(path, "r");
+    if(file == NULL) {
+        fprintf(stderr, "Cannot open \"%s\"\n", path);
+        return false;
+    }
+
+    memset(script, 0, sizeof(TamaHostScript));
+    uint32_t batch_ms = TAMA_SCRIPT_DEFAULT_BATCH_MS;
+    script->hold_ms = TAMA_SCRIPT_DEFAULT_HOLD_MS;
+    script->gap_ms = TAMA_SCRIPT_DEFAULT_GAP_MS;
+
+    bool ok = true;
+    while(ok && fgets(line, sizeof(line), file) != NULL) {
+        line_number++;
+        char* comment = strchr(line, '#');
+        if(comment != NULL) *comment = '\0';
+        line[strcspn(line, "\r\n")] = '\0';
+
+        char* save;
+        char* token = strtok_r(line, " \t", &save);
+        if(token == NULL) continue;
+
+        if(strcmp(token, "when") == 0) {
+            ok = script->rule_count < TAMA_SCRIPT_RULES_MAX &&
+                 tama_script_parse_rule(&save, &script->rules[script->rule_count++]);
+        } else if(strcmp(token, "batch") == 0) {
+            ok = tama_script_number(strtok_r(NULL, " \t", &save), &batch_ms) && batch_ms > 0;
+        } else if(strcmp(token, "hold") == 0) {
+            ok = tama_script_number(strtok_r(NULL, " \t", &save), &script->hold_ms);
+        } else if(strcmp(token, "gap") == 0) {
+            ok = tama_script_number(strtok_r(NULL, " \t", &save), &script->gap_ms);
+        } else {
+            ok = false;
+        }
+    }
+    fclose(file);
+
+    if(!ok) {
+        fprintf(stderr, "Bad script line %d in \"%s\"\n", line_number, path);
+        return false;
+    }
+
+    tama_host_batch_set(tama_script_ms(batch_ms), tama_script_batch, script);
+    return true;
+}
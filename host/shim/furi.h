@@ -0,0 +1,114 @@
+#pragma once
+
+/*
+ * Linux stand-in for the part of Furi the app's views build against, for the
+ * render benchmark. Only what the views and tama.h use is provided; see
+ * shim.h for the hooks that drive views and inspect the canvas.
+ */
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNUSED(x)      (void)(x)
+#define COUNT_OF(x)    (sizeof(x) / sizeof(x[0]))
+#define furi_assert(x) assert(x)
+#define furi_check(x)  assert(x)
+#define furi_crash(message)          \
+    do {                             \
+        fputs(message "\n", stderr); \
+        abort();                     \
+    } while(0)
+#define EXT_PATH(path) ("ext/" path)
+
+typedef enum {
+    FuriStatusOk = 0,
+    FuriStatusError = -1,
+    FuriStatusErrorTimeout = -2,
+    FuriStatusErrorResource = -3,
+} FuriStatus;
+
+#define FuriWaitForever 0xFFFFFFFFU
+
+typedef enum {
+    FuriFlagWaitAny = 0,
+    FuriFlagWaitAll = 1,
+    FuriFlagNoClear = 2,
+    FuriFlagError = 0x80000000U,
+} FuriFlag;
+
+// Errors and warnings go to stderr, the rest would only skew timings
+void furi_shim_log(const char* level, const char* tag, const char* format, ...);
+#define FURI_LOG_E(tag, ...) furi_shim_log("E", tag, __VA_ARGS__)
+#define FURI_LOG_W(tag, ...) furi_shim_log("W", tag, __VA_ARGS__)
+#define FURI_LOG_I(tag, ...) \
+    do {                     \
+    } while(0)
+#define FURI_LOG_D(tag, ...) \
+    do {                     \
+    } while(0)
+#define FURI_LOG_T(tag, ...) \
+    do {                     \
+    } while(0)
+
+uint32_t furi_get_tick(void);
+uint32_t furi_kernel_get_tick_frequency(void);
+void furi_delay_tick(uint32_t ticks);
+void furi_delay_ms(uint32_t ms);
+
+void furi_shim_critical_enter(void);
+void furi_shim_critical_exit(void);
+#define FURI_CRITICAL_ENTER() furi_shim_critical_enter()
+#define FURI_CRITICAL_EXIT()  furi_shim_critical_exit()
+
+typedef enum {
+    FuriMutexTypeNormal,
+    FuriMutexTypeRecursive,
+} FuriMutexType;
+
+typedef struct FuriMutex FuriMutex;
+FuriMutex* furi_mutex_alloc(FuriMutexType type);
+void furi_mutex_free(FuriMutex* mutex);
+FuriStatus furi_mutex_acquire(FuriMutex* mutex, uint32_t timeout);
+FuriStatus furi_mutex_release(FuriMutex* mutex);
+
+typedef struct FuriThread FuriThread;
+typedef void* FuriThreadId;
+typedef int32_t (*FuriThreadCallback)(void* context);
+FuriThread* furi_thread_alloc(void);
+void furi_thread_free(FuriThread* thread);
+void furi_thread_set_name(FuriThread* thread, const char* name);
+void furi_thread_set_stack_size(FuriThread* thread, size_t stack_size);
+void furi_thread_set_callback(FuriThread* thread, FuriThreadCallback callback);
+void furi_thread_set_context(FuriThread* thread, void* context);
+void furi_thread_start(FuriThread* thread);
+bool furi_thread_join(FuriThread* thread);
+FuriThreadId furi_thread_get_id(FuriThread* thread);
+FuriThreadId furi_thread_get_current_id(void);
+void furi_thread_yield(void);
+uint32_t furi_thread_flags_set(FuriThreadId thread_id, uint32_t flags);
+uint32_t furi_thread_flags_clear(uint32_t flags);
+uint32_t furi_thread_flags_get(void);
+uint32_t furi_thread_flags_wait(uint32_t flags, uint32_t options, uint32_t timeout);
+
+typedef enum {
+    FuriTimerTypeOnce,
+    FuriTimerTypePeriodic,
+} FuriTimerType;
+
+typedef struct FuriTimer FuriTimer;
+typedef void (*FuriTimerCallback)(void* context);
+FuriTimer* furi_timer_alloc(FuriTimerCallback callback, FuriTimerType type, void* context);
+void furi_timer_free(FuriTimer* timer);
+FuriStatus furi_timer_start(FuriTimer* timer, uint32_t ticks);
+FuriStatus furi_timer_stop(FuriTimer* timer);
+
+// Named in tama.h only, the views never touch them
+typedef struct FuriMessageQueue FuriMessageQueue;
+typedef struct FuriStreamBuffer FuriStreamBuffer;
+
+void* furi_record_open(const char* name);
+void furi_record_close(const char* name);
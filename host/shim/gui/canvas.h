@@ -0,0 +1,35 @@
+#pragma once
+
+#include <furi.h>
+
+typedef struct Canvas Canvas;
+
+typedef enum {
+    FontPrimary,
+    FontSecondary,
+    FontKeyboard,
+    FontBigNumbers,
+} Font;
+
+typedef enum {
+    ColorWhite,
+    ColorBlack,
+    ColorXOR,
+} Color;
+
+size_t canvas_width(const Canvas* canvas);
+size_t canvas_height(const Canvas* canvas);
+void canvas_clear(Canvas* canvas);
+void canvas_set_color(Canvas* canvas, Color color);
+void canvas_set_font(Canvas* canvas, Font font);
+void canvas_draw_dot(Canvas* canvas, int32_t x, int32_t y);
+void canvas_draw_box(Canvas* canvas, int32_t x, int32_t y, size_t width, size_t height);
+void canvas_draw_xbm(
+    Canvas* canvas,
+    int32_t x,
+    int32_t y,
+    size_t width,
+    size_t height,
+    const uint8_t* bitmap);
+// Counted, but text is not rendered
+void canvas_draw_str(Canvas* canvas, int32_t x, int32_t y, const char* str);
@@ -0,0 +1,3 @@
+#pragma once
+
+#include <gui/icon_i.h>
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <furi.h>
+
+typedef struct {
+    const uint16_t width;
+    const uint16_t height;
+    const uint8_t frame_count;
+    const uint8_t frame_rate;
+    const uint8_t* const* frames;
+} Icon;
+
+const uint8_t* icon_get_data(const Icon* icon);
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <furi.h>
+#include <gui/canvas.h>
+#include <gui/icon.h>
+#include <input/input.h>
+
+typedef struct View View;
+
+typedef enum {
+    ViewModelTypeNone,
+    ViewModelTypeLocking,
+    ViewModelTypeLockFree,
+} ViewModelType;
+
+typedef void (*ViewDrawCallback)(Canvas* canvas, void* model);
+typedef bool (*ViewInputCallback)(InputEvent* event, void* context);
+typedef void (*ViewCallback)(void* context);
+
+View* view_alloc(void);
+void view_free(View* view);
+void view_set_context(View* view, void* context);
+void view_set_draw_callback(View* view, ViewDrawCallback callback);
+void view_set_input_callback(View* view, ViewInputCallback callback);
+void view_set_enter_callback(View* view, ViewCallback callback);
+void view_set_exit_callback(View* view, ViewCallback callback);
+void view_allocate_model(View* view, ViewModelType type, size_t size);
+void* view_get_model(View* view);
+void view_commit_model(View* view, bool update);
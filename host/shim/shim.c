@@ -0,0 +1,698 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <gui/canvas.h>
+#include <gui/icon_i.h>
+#include <gui/modules/variable_item_list.h>
+#include <gui/view.h>
+#include <storage/storage.h>
+#include <toolbox/compress.h>
+#include "shim.h"
+
+void furi_shim_log(const char* level, const char* tag, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "[%s][%s] ", level, tag);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+// Kernel
+
+uint32_t furi_get_tick(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+uint32_t furi_kernel_get_tick_frequency(void) {
+    return 1000;
+}
+
+void furi_delay_tick(uint32_t ticks) {
+    usleep(ticks * 1000);
+}
+
+void furi_delay_ms(uint32_t ms) {
+    usleep(ms * 1000);
+}
+
+static pthread_mutex_t furi_shim_critical = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+void furi_shim_critical_enter(void) {
+    pthread_mutex_lock(&furi_shim_critical);
+}
+
+void furi_shim_critical_exit(void) {
+    pthread_mutex_unlock(&furi_shim_critical);
+}
+
+static void furi_shim_deadline(struct timespec* deadline, uint32_t timeout) {
+    clock_gettime(CLOCK_REALTIME, deadline);
+    deadline->tv_sec += timeout / 1000;
+    deadline->tv_nsec += (timeout % 1000) * 1000000L;
+    if(deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
+
+// Mutex
+
+struct FuriMutex {
+    pthread_mutex_t mutex;
+};
+
+FuriMutex* furi_mutex_alloc(FuriMutexType type) {
+    FuriMutex* mutex = malloc(sizeof(FuriMutex));
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    if(type == FuriMutexTypeRecursive) pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&mutex->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    return mutex;
+}
+
+void furi_mutex_free(FuriMutex* mutex) {
+    pthread_mutex_destroy(&mutex->mutex);
+    free(mutex);
+}
+
+FuriStatus furi_mutex_acquire(FuriMutex* mutex, uint32_t timeout) {
+    int ret;
+    if(timeout == FuriWaitForever) {
+        ret = pthread_mutex_lock(&mutex->mutex);
+    } else if(timeout == 0) {
+        ret = pthread_mutex_trylock(&mutex->mutex);
+    } else {
+        struct timespec deadline;
+        furi_shim_deadline(&deadline, timeout);
+        ret = pthread_mutex_timedlock(&mutex->mutex, &deadline);
+    }
+
+    if(ret == 0) return FuriStatusOk;
+    return ret == ETIMEDOUT || ret == EBUSY ? FuriStatusErrorTimeout : FuriStatusError;
+}
+
+FuriStatus furi_mutex_release(FuriMutex* mutex) {
+    return pthread_mutex_unlock(&mutex->mutex) == 0 ? FuriStatusOk : FuriStatusError;
+}
+
+// Thread
+
+struct FuriThread {
+    pthread_t pthread;
+    FuriThreadCallback callback;
+    void* context;
+    pthread_mutex_t flags_mutex;
+    pthread_cond_t flags_cond;
+    uint32_t flags;
+};
+
+static __thread FuriThread* furi_shim_current;
+
+static void furi_shim_thread_init(FuriThread* thread) {
+    memset(thread, 0, sizeof(FuriThread));
+    pthread_mutex_init(&thread->flags_mutex, NULL);
+    pthread_cond_init(&thread->flags_cond, NULL);
+}
+
+static FuriThread* furi_shim_thread_current(void) {
+    // Threads not started through Furi, like main, get flags on first use
+    if(furi_shim_current == NULL) {
+        furi_shim_current = malloc(sizeof(FuriThread));
+        furi_shim_thread_init(furi_shim_current);
+        furi_shim_current->pthread = pthread_self();
+    }
+    return furi_shim_current;
+}
+
+FuriThread* furi_thread_alloc(void) {
+    FuriThread* thread = malloc(sizeof(FuriThread));
+    furi_shim_thread_init(thread);
+    return thread;
+}
+
+void furi_thread_free(FuriThread* thread) {
+    pthread_mutex_destroy(&thread->flags_mutex);
+    pthread_cond_destroy(&thread->flags_cond);
+    free(thread);
+}
+
+void furi_thread_set_name(FuriThread* thread, const char* name) {
+    UNUSED(thread);
+    UNUSED(name);
+}
+
+void furi_thread_set_stack_size(FuriThread* thread, size_t stack_size) {
+    UNUSED(thread);
+    UNUSED(stack_size);
+}
+
+void furi_thread_set_callback(FuriThread* thread, FuriThreadCallback callback) {
+    thread->callback = callback;
+}
+
+void furi_thread_set_context(FuriThread* thread, void* context) {
+    thread->context = context;
+}
+
+static void* furi_shim_thread_body(void* arg) {
+    FuriThread* thread = arg;
+    furi_shim_current = thread;
+    thread->callback(thread->context);
+    return NULL;
+}
+
+void furi_thread_start(FuriThread* thread) {
+    pthread_create(&thread->pthread, NULL, furi_shim_thread_body, thread);
+}
+
+bool furi_thread_join(FuriThread* thread) {
+    return pthread_join(thread->pthread, NULL) == 0;
+}
+
+FuriThreadId furi_thread_get_id(FuriThread* thread) {
+    return thread;
+}
+
+FuriThreadId furi_thread_get_current_id(void) {
+    return furi_shim_thread_current();
+}
+
+void furi_thread_yield(void) {
+    sched_yield();
+}
+
+uint32_t furi_thread_flags_set(FuriThreadId thread_id, uint32_t flags) {
+    FuriThread* thread = thread_id;
+    pthread_mutex_lock(&thread->flags_mutex);
+    thread->flags |= flags;
+    uint32_t result = thread->flags;
+    pthread_cond_broadcast(&thread->flags_cond);
+    pthread_mutex_unlock(&thread->flags_mutex);
+    return result;
+}
+
+uint32_t furi_thread_flags_clear(uint32_t flags) {
+    FuriThread* thread = furi_shim_thread_current();
+    pthread_mutex_lock(&thread->flags_mutex);
+    uint32_t result = thread->flags;
+    thread->flags &= ~flags;
+    pthread_mutex_unlock(&thread->flags_mutex);
+    return result;
+}
+
+uint32_t furi_thread_flags_get(void) {
+    FuriThread* thread = furi_shim_thread_current();
+    pthread_mutex_lock(&thread->flags_mutex);
+    uint32_t result = thread->flags;
+    pthread_mutex_unlock(&thread->flags_mutex);
+    return result;
+}
+
+uint32_t furi_thread_flags_wait(uint32_t flags, uint32_t options, uint32_t timeout) {
+    FuriThread* thread = furi_shim_thread_current();
+    struct timespec deadline;
+    uint32_t result = (uint32_t)FuriStatusErrorTimeout;
+
+    furi_shim_deadline(&deadline, timeout);
+    pthread_mutex_lock(&thread->flags_mutex);
+    while(true) {
+        uint32_t set = thread->flags & flags;
+        if((options & FuriFlagWaitAll) ? set == flags : set != 0) {
+            result = thread->flags;
+            if(!(options & FuriFlagNoClear)) thread->flags &= ~flags;
+            break;
+        }
+        if(timeout == 0) break;
+        if(timeout == FuriWaitForever) {
+            pthread_cond_wait(&thread->flags_cond, &thread->flags_mutex);
+        } else if(
+            pthread_cond_timedwait(&thread->flags_cond, &thread->flags_mutex, &deadline) ==
+            ETIMEDOUT) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&thread->flags_mutex);
+    return result;
+}
+
+// Timer, one thread per running timer
+
+struct FuriTimer {
+    FuriTimerCallback callback;
+    FuriTimerType type;
+    void* context;
+    FuriThread* thread;
+    uint32_t ticks;
+};
+
+#define FURI_SHIM_TIMER_STOP (1 << 0)
+
+static int32_t furi_shim_timer_body(void* context) {
+    FuriTimer* timer = context;
+    do {
+        if(furi_thread_flags_wait(FURI_SHIM_TIMER_STOP, FuriFlagWaitAny, timer->ticks) ==
+           FURI_SHIM_TIMER_STOP)
+            break;
+        timer->callback(timer->context);
+    } while(timer->type == FuriTimerTypePeriodic);
+    return 0;
+}
+
+FuriTimer* furi_timer_alloc(FuriTimerCallback callback, FuriTimerType type, void* context) {
+    FuriTimer* timer = calloc(1, sizeof(FuriTimer));
+    timer->callback = callback;
+    timer->type = type;
+    timer->context = context;
+    return timer;
+}
+
+void furi_timer_free(FuriTimer* timer) {
+    furi_timer_stop(timer);
+    free(timer);
+}
+
+FuriStatus furi_timer_start(FuriTimer* timer, uint32_t ticks) {
+    furi_timer_stop(timer);
+    timer->ticks = ticks;
+    timer->thread = furi_thread_alloc();
+    furi_thread_set_callback(timer->thread, furi_shim_timer_body);
+    furi_thread_set_context(timer->thread, timer);
+    furi_thread_start(timer->thread);
+    return FuriStatusOk;
+}
+
+FuriStatus furi_timer_stop(FuriTimer* timer) {
+    if(timer->thread == NULL) return FuriStatusOk;
+    furi_thread_flags_set(furi_thread_get_id(timer->thread), FURI_SHIM_TIMER_STOP);
+    furi_thread_join(timer->thread);
+    furi_thread_free(timer->thread);
+    timer->thread = NULL;
+    return FuriStatusOk;
+}
+
+// Records
+
+void* furi_record_open(const char* name) {
+    // Only storage is ever opened, and its functions ignore the handle
+    UNUSED(name);
+    return NULL;
+}
+
+void furi_record_close(const char* name) {
+    UNUSED(name);
+}
+
+// Canvas
+
+struct Canvas {
+    uint8_t pixels[CANVAS_SHIM_HEIGHT][CANVAS_SHIM_WIDTH];
+    Color color;
+    uint32_t draw_calls;
+};
+
+Canvas* canvas_shim_alloc(void) {
+    return calloc(1, sizeof(Canvas));
+}
+
+void canvas_shim_free(Canvas* canvas) {
+    free(canvas);
+}
+
+void canvas_shim_reset(Canvas* canvas) {
+    memset(canvas->pixels, 0, sizeof(canvas->pixels));
+    canvas->color = ColorBlack;
+    canvas->draw_calls = 0;
+}
+
+uint32_t canvas_shim_draw_calls(Canvas* canvas) {
+    return canvas->draw_calls;
+}
+
+bool canvas_shim_get_pixel(Canvas* canvas, int32_t x, int32_t y) {
+    if(x < 0 || y < 0 || x >= CANVAS_SHIM_WIDTH || y >= CANVAS_SHIM_HEIGHT) return false;
+    return canvas->pixels[y][x];
+}
+
+static void canvas_shim_set_pixel(Canvas* canvas, int32_t x, int32_t y) {
+    if(x < 0 || y < 0 || x >= CANVAS_SHIM_WIDTH || y >= CANVAS_SHIM_HEIGHT) return;
+    if(canvas->color == ColorXOR)
+        canvas->pixels[y][x] ^= 1;
+    else
+        canvas->pixels[y][x] = canvas->color == ColorBlack;
+}
+
+size_t canvas_width(const Canvas* canvas) {
+    UNUSED(canvas);
+    return CANVAS_SHIM_WIDTH;
+}
+
+size_t canvas_height(const Canvas* canvas) {
+    UNUSED(canvas);
+    return CANVAS_SHIM_HEIGHT;
+}
+
+void canvas_clear(Canvas* canvas) {
+    memset(canvas->pixels, 0, sizeof(canvas->pixels));
+    canvas->draw_calls++;
+}
+
+void canvas_set_color(Canvas* canvas, Color color) {
+    canvas->color = color;
+}
+
+void canvas_set_font(Canvas* canvas, Font font) {
+    UNUSED(canvas);
+    UNUSED(font);
+}
+
+void canvas_draw_dot(Canvas* canvas, int32_t x, int32_t y) {
+    canvas->draw_calls++;
+    canvas_shim_set_pixel(canvas, x, y);
+}
+
+void canvas_draw_box(Canvas* canvas, int32_t x, int32_t y, size_t width, size_t height) {
+    canvas->draw_calls++;
+    for(size_t j = 0; j < height; j++) {
+        for(size_t i = 0; i < width; i++)
+            canvas_shim_set_pixel(canvas, x + i, y + j);
+    }
+}
+
+void canvas_draw_xbm(
+    Canvas* canvas,
+    int32_t x,
+    int32_t y,
+    size_t width,
+    size_t height,
+    const uint8_t* bitmap) {
+    size_t stride = (width + 7) / 8;
+
+    canvas->draw_calls++;
+    for(size_t j = 0; j < height; j++) {
+        for(size_t i = 0; i < width; i++) {
+            if(bitmap[j * stride + i / 8] & (1 << (i % 8)))
+                canvas_shim_set_pixel(canvas, x + i, y + j);
+        }
+    }
+}
+
+void canvas_draw_str(Canvas* canvas, int32_t x, int32_t y, const char* str) {
+    UNUSED(x);
+    UNUSED(y);
+    UNUSED(str);
+    canvas->draw_calls++;
+}
+
+// Icons
+
+const uint8_t* icon_get_data(const Icon* icon) {
+    return icon->frames[0];
+}
+
+struct CompressIcon {
+    size_t size;
+    uint8_t* buffer;
+};
+
+CompressIcon* compress_icon_alloc(size_t decode_buf_size) {
+    CompressIcon* instance = malloc(sizeof(CompressIcon));
+    instance->size = decode_buf_size;
+    instance->buffer = malloc(decode_buf_size);
+    return instance;
+}
+
+void compress_icon_free(CompressIcon* instance) {
+    free(instance->buffer);
+    free(instance);
+}
+
+static uint32_t compress_shim_bits(const uint8_t* data, size_t size, size_t* bit, uint8_t count) {
+    uint32_t value = 0;
+    for(uint8_t i = 0; i < count; i++, (*bit)++) {
+        if(*bit / 8 >= size) return UINT32_MAX;
+        value = (value << 1) | ((data[*bit / 8] >> (7 - *bit % 8)) & 1);
+    }
+    return value;
+}
+
+void compress_icon_decode(CompressIcon* instance, const uint8_t* icon_data, uint8_t** output) {
+    *output = instance->buffer;
+    if(icon_data[0] == 0) {
+        memcpy(instance->buffer, &icon_data[1], instance->size);
+        return;
+    }
+
+    // Header: flag, reserved, then the compressed size, little endian
+    const uint8_t* data = &icon_data[4];
+    size_t size = icon_data[2] | (icon_data[3] << 8);
+    size_t bit = 0;
+    size_t out = 0;
+    memset(instance->buffer, 0, instance->size);
+    while(out < instance->size) {
+        uint32_t tag = compress_shim_bits(data, size, &bit, 1);
+        if(tag == UINT32_MAX) break;
+        if(tag) {
+            uint32_t literal = compress_shim_bits(data, size, &bit, 8);
+            if(literal == UINT32_MAX) break;
+            instance->buffer[out++] = literal;
+        } else {
+            uint32_t index = compress_shim_bits(data, size, &bit, 8);
+            uint32_t count = compress_shim_bits(data, size, &bit, 4);
+            if(index == UINT32_MAX || count == UINT32_MAX) break;
+            // The window starts out zeroed, so references before the start read 0
+            for(uint32_t i = 0; i <= count && out < instance->size; i++, out++)
+                instance->buffer[out] = out > index ? instance->buffer[out - index - 1] : 0;
+        }
+    }
+}
+
+// View
+
+struct View {
+    void* context;
+    ViewDrawCallback draw_callback;
+    ViewInputCallback input_callback;
+    ViewCallback enter_callback;
+    ViewCallback exit_callback;
+    VariableItemList* list;
+    void* model;
+};
+
+View* view_alloc(void) {
+    return calloc(1, sizeof(View));
+}
+
+void view_free(View* view) {
+    free(view->model);
+    free(view);
+}
+
+void view_set_context(View* view, void* context) {
+    view->context = context;
+}
+
+void view_set_draw_callback(View* view, ViewDrawCallback callback) {
+    view->draw_callback = callback;
+}
+
+void view_set_input_callback(View* view, ViewInputCallback callback) {
+    view->input_callback = callback;
+}
+
+void view_set_enter_callback(View* view, ViewCallback callback) {
+    view->enter_callback = callback;
+}
+
+void view_set_exit_callback(View* view, ViewCallback callback) {
+    view->exit_callback = callback;
+}
+
+void view_allocate_model(View* view, ViewModelType type, size_t size) {
+    // Nothing to lock, the shim draws on the caller's thread
+    UNUSED(type);
+    view->model = calloc(1, size);
+}
+
+void* view_get_model(View* view) {
+    return view->model;
+}
+
+void view_commit_model(View* view, bool update) {
+    UNUSED(view);
+    UNUSED(update);
+}
+
+void view_shim_draw(View* view, Canvas* canvas) {
+    // Views without a model get NULL, like on the device
+    if(view->draw_callback) view->draw_callback(canvas, view->model);
+}
+
+bool view_shim_input(View* view, InputEvent* event) {
+    return view->input_callback ? view->input_callback(event, view->context) : false;
+}
+
+void view_shim_enter(View* view) {
+    if(view->enter_callback) view->enter_callback(view->context);
+}
+
+void view_shim_exit(View* view) {
+    if(view->exit_callback) view->exit_callback(view->context);
+}
+
+// VariableItemList
+
+#define VARIABLE_ITEM_LIST_SHIM_MAX 32
+
+struct VariableItem {
+    const char* label;
+    uint8_t values_count;
+    uint8_t current_value_index;
+    const char* current_value_text;
+    VariableItemChangeCallback change_callback;
+    void* context;
+};
+
+struct VariableItemList {
+    View* view;
+    VariableItem items[VARIABLE_ITEM_LIST_SHIM_MAX];
+    uint8_t count;
+    VariableItemListEnterCallback enter_callback;
+    void* enter_context;
+};
+
+VariableItemList* variable_item_list_alloc(void) {
+    VariableItemList* list = calloc(1, sizeof(VariableItemList));
+    list->view = view_alloc();
+    list->view->list = list;
+    return list;
+}
+
+void variable_item_list_free(VariableItemList* list) {
+    view_free(list->view);
+    free(list);
+}
+
+View* variable_item_list_get_view(VariableItemList* list) {
+    return list->view;
+}
+
+VariableItem* variable_item_list_add(
+    VariableItemList* list,
+    const char* label,
+    uint8_t values_count,
+    VariableItemChangeCallback change_callback,
+    void* context) {
+    furi_check(list->count < VARIABLE_ITEM_LIST_SHIM_MAX);
+    VariableItem* item = &list->items[list->count++];
+    item->label = label;
+    item->values_count = values_count;
+    item->change_callback = change_callback;
+    item->context = context;
+    return item;
+}
+
+void variable_item_list_set_enter_callback(
+    VariableItemList* list,
+    VariableItemListEnterCallback callback,
+    void* context) {
+    list->enter_callback = callback;
+    list->enter_context = context;
+}
+
+void variable_item_set_current_value_index(VariableItem* item, uint8_t current_value_index) {
+    item->current_value_index = current_value_index;
+}
+
+void variable_item_set_current_value_text(VariableItem* item, const char* current_value_text) {
+    item->current_value_text = current_value_text;
+}
+
+uint8_t variable_item_get_current_value_index(VariableItem* item) {
+    return item->current_value_index;
+}
+
+void* variable_item_get_context(VariableItem* item) {
+    return item->context;
+}
+
+VariableItem* variable_item_list_shim_find(View* view, const char* label) {
+    VariableItemList* list = view->list;
+    furi_check(list != NULL);
+    for(uint8_t i = 0; i < list->count; i++) {
+        if(!strcmp(list->items[i].label, label)) return &list->items[i];
+    }
+    furi_crash("No such menu item");
+}
+
+void variable_item_list_shim_change(VariableItem* item, uint8_t value) {
+    item->current_value_index = value;
+    if(item->change_callback) item->change_callback(item);
+}
+
+// Storage, straight onto stdio
+
+struct File {
+    FILE* file;
+};
+
+File* storage_file_alloc(Storage* storage) {
+    UNUSED(storage);
+    return calloc(1, sizeof(File));
+}
+
+void storage_file_free(File* file) {
+    free(file);
+}
+
+bool storage_file_open(
+    File* file,
+    const char* path,
+    FS_AccessMode access_mode,
+    FS_OpenMode open_mode) {
+    const char* mode = "rb";
+    if(access_mode & FSAM_WRITE) {
+        if(open_mode & (FSOM_CREATE_ALWAYS | FSOM_CREATE_NEW))
+            mode = access_mode & FSAM_READ ? "w+b" : "wb";
+        else if(open_mode & FSOM_OPEN_APPEND)
+            mode = "ab";
+        else
+            mode = "r+b";
+    }
+    file->file = fopen(path, mode);
+    return file->file != NULL;
+}
+
+bool storage_file_close(File* file) {
+    if(file->file == NULL) return false;
+    fclose(file->file);
+    file->file = NULL;
+    return true;
+}
+
+size_t storage_file_read(File* file, void* buff, size_t bytes_to_read) {
+    return file->file ? fread(buff, 1, bytes_to_read, file->file) : 0;
+}
+
+size_t storage_file_write(File* file, const void* buff, size_t bytes_to_write) {
+    return file->file ? fwrite(buff, 1, bytes_to_write, file->file) : 0;
+}
+
+FS_Error storage_common_stat(Storage* storage, const char* path, FileInfo* fileinfo) {
+    struct stat st;
+    UNUSED(storage);
+    if(stat(path, &st) != 0) return FSE_NOT_EXIST;
+    if(fileinfo != NULL) {
+        fileinfo->flags = S_ISDIR(st.st_mode) ? 1 : 0;
+        fileinfo->size = st.st_size;
+    }
+    return FSE_OK;
+}
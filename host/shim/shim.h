@@ -0,0 +1,29 @@
+#pragma once
+
+#include <furi.h>
+#include <gui/canvas.h>
+#include <gui/view.h>
+#include <gui/modules/variable_item_list.h>
+#include <input/input.h>
+
+#define CANVAS_SHIM_WIDTH  128
+#define CANVAS_SHIM_HEIGHT 64
+
+// Canvas backed by a 128x64 pixel buffer that counts the draw calls made on it
+Canvas* canvas_shim_alloc(void);
+void canvas_shim_free(Canvas* canvas);
+// Clears the pixels and the draw call count
+void canvas_shim_reset(Canvas* canvas);
+uint32_t canvas_shim_draw_calls(Canvas* canvas);
+bool canvas_shim_get_pixel(Canvas* canvas, int32_t x, int32_t y);
+
+// What the view dispatcher and GUI thread would do with a view
+void view_shim_draw(View* view, Canvas* canvas);
+bool view_shim_input(View* view, InputEvent* event);
+void view_shim_enter(View* view);
+void view_shim_exit(View* view);
+
+// Returns the VariableItemList item with label, so callers don't depend on its position
+VariableItem* variable_item_list_shim_find(View* view, const char* label);
+// Moves an item to value and runs its change callback
+void variable_item_list_shim_change(VariableItem* item, uint8_t value);
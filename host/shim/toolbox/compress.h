@@ -0,0 +1,10 @@
+#pragma once
+
+#include <furi.h>
+
+typedef struct CompressIcon CompressIcon;
+
+CompressIcon* compress_icon_alloc(size_t decode_buf_size);
+void compress_icon_free(CompressIcon* instance);
+// Handles raw and heatshrink compressed (window 8, lookahead 4) asset frames
+void compress_icon_decode(CompressIcon* instance, const uint8_t* icon_data, uint8_t** output);
@@ -0,0 +1,264 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <tamalib.h>
+#include "../tama_buzzer.h"
+#include "../tama_capture.h"
+#include "../tama_lcd.h"
+#include "../tama_movie.h"
+#include "../tama_state.h"
+#include "wav.h"
+
+#define TAMA_HOST_DEFAULT_SECONDS 60
+#define TAMA_HOST_CAPTURE_RATE    30
+
+#define TAMA_SCRIPT_RULES_MAX   32
+#define TAMA_SCRIPT_CONDS_MAX   8
+#define TAMA_SCRIPT_ACTIONS_MAX 16
+
+#define TAMA_DEBUG_PC_SIZE   (1 << 13) // 13-bit program counter
+#define TAMA_DEBUG_PAGE_BITS 8 // log2 of the PCs one breakpoint page covers
+#define TAMA_DEBUG_WATCH_MAX 16
+
+// Tick and step count, then the CPU state, see trace.c
+#define TAMA_TRACE_RECORD_SIZE (16 + TAMA_STATE_SIZE)
+
+typedef struct {
+    const char* rom_path;
+    const char* state_path;
+    const char* movie_path;
+    const char* wav_path;
+    const char* golden_path;
+    const char* capture_path;
+    const char* script_path;
+    const char* trace_path;
+    uint64_t trace_period; // CPU ticks between trace records, 0 for one second
+    uint64_t trace_start; // CPU tick of the first trace record
+    bool golden_write; // Record golden_path instead of checking against it
+    bool debug; // Start at the debugger prompt, TAMA_DEBUGGER builds only
+    // 0 runs until the movie ends, or TAMA_HOST_DEFAULT_SECONDS without one
+    uint32_t seconds;
+} TamaHostJob;
+
+// TamaLIB callbacks made, TAMA_PROFILE_DIAG builds only
+typedef struct {
+    uint64_t lcd_matrix;
+    uint64_t lcd_icon;
+    uint64_t set_frequency;
+    uint64_t play_frequency;
+    uint64_t logs;
+} TamaHostDiag;
+
+typedef struct {
+    uint64_t ticks;
+    uint64_t steps;
+    double elapsed;
+    uint32_t movie_events;
+    uint32_t script_fired;
+    uint32_t script_presses;
+    uint32_t hash; // Framebuffer and icons at the end of the run
+    bool halted;
+    bool diverged;
+    uint64_t divergent_tick;
+#ifdef TAMA_PROFILE_DIAG
+    TamaHostDiag diag;
+#endif
+} TamaHostResult;
+
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    size_t pos;
+    TamaMovieEvent next;
+    uint32_t last_tick;
+    uint32_t events;
+    bool active;
+} TamaHostMovie;
+
+typedef struct {
+    FILE* file;
+    bool write;
+    bool diverged;
+    uint64_t next_tick;
+    uint64_t divergent_tick;
+    uint32_t samples;
+} TamaHostGolden;
+
+typedef struct {
+    FILE* file;
+    bool key;
+    uint64_t next_tick;
+    uint64_t last_tick;
+    uint64_t samples;
+    uint32_t frames;
+    uint32_t framebuffer[16];
+    uint8_t icons;
+} TamaHostCapture;
+
+typedef struct {
+    FILE* file;
+    uint64_t next_tick;
+    uint64_t period;
+    uint64_t records;
+} TamaHostTrace;
+
+// Called between two steps every period CPU ticks, see tama_host_batch_set
+typedef void (*TamaHostBatchCallback)(uint64_t ticks, void* context);
+
+typedef struct {
+    uint64_t next_tick;
+    uint64_t next_period; // next_tick unless tama_host_batch_at moved it closer
+    uint64_t period;
+    TamaHostBatchCallback callback;
+    void* context;
+} TamaHostBatch;
+
+typedef enum {
+    TamaScriptOpEq,
+    TamaScriptOpNe,
+    TamaScriptOpLt,
+    TamaScriptOpGt,
+    TamaScriptOpLe,
+    TamaScriptOpGe,
+} TamaScriptOp;
+
+typedef enum {
+    TamaScriptCondMemory,
+    TamaScriptCondPixels,
+    TamaScriptCondIcon,
+    TamaScriptCondNoIcon,
+    TamaScriptCondBlank,
+    TamaScriptCondAfter,
+} TamaScriptCondType;
+
+typedef struct {
+    TamaScriptCondType type;
+    TamaScriptOp op;
+    uint16_t arg; // Memory address or icon
+    uint32_t operand;
+} TamaScriptCond;
+
+typedef struct {
+    TamaScriptCond conds[TAMA_SCRIPT_CONDS_MAX];
+    uint8_t cond_count;
+    uint8_t actions[TAMA_SCRIPT_ACTIONS_MAX]; // button_t, or a wait
+    uint8_t action_count;
+    uint32_t cooldown; // Emulated seconds
+    uint64_t rest_until;
+    uint32_t fired;
+} TamaScriptRule;
+
+typedef struct {
+    TamaScriptRule rules[TAMA_SCRIPT_RULES_MAX];
+    uint8_t rule_count;
+    uint32_t hold_ms;
+    uint32_t gap_ms;
+    // Sequence of the rule that fired last
+    uint8_t actions[TAMA_SCRIPT_ACTIONS_MAX];
+    uint8_t action_count;
+    uint8_t action;
+    bool pressed;
+    uint64_t next_tick;
+    uint32_t fired;
+    uint32_t presses;
+} TamaHostScript;
+
+typedef struct {
+    uint16_t addr;
+    uint8_t value; // As of the last check
+} TamaDebugWatch;
+
+typedef struct {
+    bool armed; // Anything for tama_host_debug_check to look at
+    uint64_t steps; // Left until the prompt, 0 when not single stepping
+    uint32_t pages; // One bit per breakpoint page that has any
+    uint8_t breakpoints[TAMA_DEBUG_PC_SIZE / 8];
+    uint16_t breakpoint_count;
+    TamaDebugWatch watches[TAMA_DEBUG_WATCH_MAX];
+    uint8_t watch_count;
+} TamaHostDebug;
+
+typedef struct {
+    uint8_t* rom;
+    size_t rom_size;
+    hal_t hal;
+    // 32x16 screen, same layout as TamaApp
+    uint32_t framebuffer[16];
+    uint8_t icons;
+    bool lcd_dirty;
+    bool halted;
+    TamaBuzzer buzzer;
+    TamaWav* wav;
+    // CPU ticks since start, widened from the 32-bit TamaLIB tick counter
+    uint64_t ticks;
+    uint32_t last_tick;
+    // TamaLIB tick of the earliest golden, capture, trace, batch, movie or end deadline
+    uint32_t next_event;
+    TamaHostMovie movie;
+    TamaHostGolden golden;
+    TamaHostCapture capture;
+    TamaHostTrace trace;
+    TamaHostBatch batch;
+    TamaHostScript script;
+#ifdef TAMA_DEBUGGER
+    TamaHostDebug debug;
+#endif
+#ifdef TAMA_PROFILE_DIAG
+    TamaHostDiag diag;
+#endif
+} TamaHost;
+
+extern TamaHost g_host;
+
+void tama_host_usage(const char* name);
+// Returns 1 on success, 0 when help was asked for and -1 on bad arguments
+int tama_host_parse_args(int argc, char** argv, TamaHostJob* job);
+// Runs one job on the process wide TamaLIB instance
+bool tama_host_run(const TamaHostJob* job, TamaHostResult* result);
+uint32_t tama_host_frame_hash(void);
+
+/*
+ * Hooks callback in between steps once every period CPU ticks, e.g. to look
+ * at memory and the LCD and press buttons, which the next step then sees.
+ * A period of 0 removes it.
+ */
+void tama_host_batch_set(uint64_t period, TamaHostBatchCallback callback, void* context);
+// Calls the batch callback once more at tick, if that comes before its next period
+void tama_host_batch_at(uint64_t tick);
+// Nibble at a CPU address, RAM or I/O
+uint8_t tama_host_memory(uint16_t addr);
+
+void tama_host_hal_init(hal_t* hal);
+uint64_t tama_host_ticks(void);
+void tama_host_lcd_sync(void);
+
+bool tama_host_movie_load(uint8_t* data, size_t size);
+void tama_host_movie_step(void);
+
+bool tama_host_golden_open(const char* path, bool write);
+// Takes the frame hash once golden.next_tick is reached
+void tama_host_golden_sample(uint64_t ticks);
+// Checks that a run ending at ticks used up the golden file, as one halting early fails
+void tama_host_golden_finish(uint64_t ticks);
+void tama_host_golden_close(void);
+
+bool tama_host_capture_open(const char* path);
+// Writes a frame once capture.next_tick is reached, if the LCD changed
+void tama_host_capture_sample(uint64_t ticks);
+void tama_host_capture_close(void);
+
+bool tama_host_trace_open(const char* path, uint64_t period, uint64_t start);
+// Writes a record once trace.next_tick is reached, steps being those run so far
+void tama_host_trace_sample(uint64_t ticks, uint64_t steps);
+void tama_host_trace_close(void);
+
+// Parses a rule script and hooks it up as the batch callback
+bool tama_host_script_load(const char* path);
+
+// Reads debugger commands from stdin until one resumes the run, false to stop it
+bool tama_host_debug_prompt(void);
+// Called after a step while debug.armed, true if the prompt is due
+bool tama_host_debug_check(void);
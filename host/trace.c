@@ -0,0 +1,46 @@
+#include <stdio.h>
+#include "tama_host.h"
+
+/*
+ * Lockstep traces for tama_lockstep: one record every period CPU ticks from
+ * start on, made of the tick and step count (u64, little endian) and the CPU
+ * state in the save file format. A period of 1 records after every step.
+ */
+
+static void tama_host_trace_put64(uint8_t* buf, uint64_t value) {
+    for(size_t i = 0; i < 8; i++) buf[i] = value >> (i * 8);
+}
+
+bool tama_host_trace_open(const char* path, uint64_t period, uint64_t start) {
+    TamaHostTrace* trace = &g_host.trace;
+
+    trace->file = fopen(path, "wb");
+    if(trace->file == NULL) {
+        fprintf(stderr, "Cannot create \"%s\"\n", path);
+        return false;
+    }
+
+    trace->period = period ? period : TICK_FREQUENCY;
+    trace->next_tick = start;
+    trace->records = 0;
+    return true;
+}
+
+void tama_host_trace_sample(uint64_t ticks, uint64_t steps) {
+    TamaHostTrace* trace = &g_host.trace;
+    uint8_t record[TAMA_TRACE_RECORD_SIZE];
+
+    tama_host_trace_put64(record, ticks);
+    tama_host_trace_put64(record + 8, steps);
+    tama_state_save(record + 16);
+    fwrite(record, 1, sizeof(record), trace->file);
+    trace->records++;
+    trace->next_tick = ticks + trace->period;
+}
+
+void tama_host_trace_close(void) {
+    TamaHostTrace* trace = &g_host.trace;
+
+    if(trace->file != NULL) fclose(trace->file);
+    trace->file = NULL;
+}
@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "wav.h"
+
+#define TAMA_WAV_HEADER_SIZE 44
+#define TAMA_WAV_SILENCE     0x80
+#define TAMA_WAV_HIGH        0xC0
+#define TAMA_WAV_LOW         0x40
+
+struct TamaWav {
+    FILE* file;
+    uint64_t tick;
+    uint32_t phase;
+    uint32_t phase_step;
+    uint32_t samples;
+};
+
+static void tama_wav_put_u32(uint8_t* buf, uint32_t val) {
+    buf[0] = val & 0xFF;
+    buf[1] = (val >> 8) & 0xFF;
+    buf[2] = (val >> 16) & 0xFF;
+    buf[3] = (val >> 24) & 0xFF;
+}
+
+static void tama_wav_put_u16(uint8_t* buf, uint16_t val) {
+    buf[0] = val & 0xFF;
+    buf[1] = (val >> 8) & 0xFF;
+}
+
+static void tama_wav_write_header(TamaWav* wav) {
+    uint8_t header[TAMA_WAV_HEADER_SIZE] = {
+        'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E', 'f', 'm', 't', ' ',
+        16,  0,   0,   0,   1, 0, 1, 0, 0,   0,   0,   0,   0,   0,   0,   0,
+        1,   0,   8,   0,   'd', 'a', 't', 'a', 0, 0, 0, 0,
+    };
+
+    // 8-bit unsigned mono PCM
+    tama_wav_put_u32(&header[4], 36 + wav->samples);
+    tama_wav_put_u32(&header[24], TAMA_WAV_SAMPLE_RATE);
+    tama_wav_put_u32(&header[28], TAMA_WAV_SAMPLE_RATE);
+    tama_wav_put_u16(&header[32], 1);
+    tama_wav_put_u32(&header[40], wav->samples);
+
+    fseek(wav->file, 0, SEEK_SET);
+    fwrite(header, 1, sizeof(header), wav->file);
+}
+
+static void tama_wav_render(TamaWav* wav, uint64_t tick) {
+    uint8_t buf[256];
+    size_t len = 0;
+
+    for(; wav->tick < tick; wav->tick++) {
+        if(wav->phase_step == 0) {
+            buf[len++] = TAMA_WAV_SILENCE;
+        } else {
+            buf[len++] = wav->phase < 0x80000000UL ? TAMA_WAV_HIGH : TAMA_WAV_LOW;
+            wav->phase += wav->phase_step;
+        }
+
+        if(len == sizeof(buf)) {
+            fwrite(buf, 1, len, wav->file);
+            wav->samples += len;
+            len = 0;
+        }
+    }
+
+    fwrite(buf, 1, len, wav->file);
+    wav->samples += len;
+}
+
+TamaWav* tama_wav_open(const char* path) {
+    TamaWav* wav = calloc(1, sizeof(TamaWav));
+    wav->file = fopen(path, "wb");
+    if(wav->file == NULL) {
+        free(wav);
+        return NULL;
+    }
+
+    tama_wav_write_header(wav);
+    return wav;
+}
+
+void tama_wav_event(TamaWav* wav, uint64_t tick, uint32_t frequency) {
+    tama_wav_render(wav, tick);
+    // Square wave phase step per sample, in 2^-32 of a period
+    wav->phase_step = (uint32_t)(((uint64_t)frequency << 32) / (TAMA_WAV_SAMPLE_RATE * 10ULL));
+    wav->phase = 0;
+}
+
+void tama_wav_close(TamaWav* wav, uint64_t tick) {
+    tama_wav_render(wav, tick);
+    tama_wav_write_header(wav);
+    fclose(wav->file);
+    free(wav);
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdint.h>
+
+// One sample per CPU tick keeps the buzzer timing exact
+#define TAMA_WAV_SAMPLE_RATE 32768
+
+typedef struct TamaWav TamaWav;
+
+TamaWav* tama_wav_open(const char* path);
+// tick is the absolute CPU tick the frequency (tenths of Hz, 0 is silence) starts at
+void tama_wav_event(TamaWav* wav, uint64_t tick, uint32_t frequency);
+void tama_wav_close(TamaWav* wav, uint64_t tick);
@@ -1,7 +1,14 @@
 #pragma once
 
 #include <input/input.h>
+#include <storage/storage.h>
 #include <tamalib.h>
+#include "tama_arena.h"
+#include "tama_buzzer.h"
+#include "tama_capture.h"
+#include "tama_lcd.h"
+#include "tama_movie.h"
+#include "tama_state.h"
 
 #define TAG                      "TamaP1"
 #define TAMA_BASE_PATH           EXT_PATH("tama_p1/")
@@ -9,24 +16,221 @@
 #define TAMA_SCREEN_SCALE_FACTOR 2
 #define TAMA_LCD_ICON_SIZE       14
 #define TAMA_LCD_ICON_MARGIN     1
+#define TAMA_TIMER_FREQ          64000
 
-#define STATE_FILE_MAGIC   "TLST"
-#define STATE_FILE_VERSION 2
+// Build profiles, see tama_profile in application.fam
+#ifdef TAMA_PROFILE_FAST
+#define TAMA_SPEED_DEFAULT TamaSpeedMax
+#else
+#define TAMA_SPEED_DEFAULT TamaSpeed1x
+#endif
+
+// Scheduler tuning, in TIM2 counts unless stated otherwise
+#define TAMA_SCHED_SLEEP_MIN (TAMA_TIMER_FREQ / 1000)
+#define TAMA_SCHED_BURST_MAX 512 // Late steps run back to back before yielding
+
+#define TAMA_AUDIO_QUEUE_SIZE 32
+#define TAMA_AUDIO_RELEASE_MS 250
+#define TAMA_AUDIO_EXIT_TICK  UINT32_MAX
+#define TAMA_AUDIO_EXIT_FREQ  UINT32_MAX
+
+#define TAMA_INPUT_QUEUE_SIZE 8 // Power of two
+
+#define TAMA_CAPTURE_STREAM_SIZE 4096
+#define TAMA_CAPTURE_CHUNK       512 // Bytes per SD card write
+
+#define TAMA_WORKER_FLAG_EXIT (1 << 0)
+#define TAMA_WORKER_FLAG_WAKE (1 << 1)
+
+// Low power: update timer frames the LCD must stay unchanged, and how far the
+// core may run ahead of real time before blocking, in TIM2 counts
+#define TAMA_LOWPOWER_STATIC_FRAMES 90
+#define TAMA_LOWPOWER_SLACK         (TAMA_TIMER_FREQ / 4)
+
+// Arena budget on top of TamaApp and the ROM, for TamaLIB's own allocations
+#define TAMA_ARENA_HAL_SIZE 256
+
+// Daycare: pets run by the one core, pet 0 saved as <rom>.sav and pet n as
+// <rom>.<n>.sav. Pets not shown catch up on real time every period. A pet owes
+// at most VISIT_MAX CPU ticks, time beyond that is dropped so a slow visit
+// never snowballs.
+#ifndef TAMA_DAYCARE_PETS
+#define TAMA_DAYCARE_PETS 4
+#endif
+// New pets a session has room for, on top of those with a save file at start
+#ifndef TAMA_DAYCARE_ADOPT_MAX
+#define TAMA_DAYCARE_ADOPT_MAX 1
+#endif
+#define TAMA_DAYCARE_PERIOD_MS     1000
+#define TAMA_DAYCARE_VISIT_MAX     (TICK_FREQUENCY * 2)
+#define TAMA_DAYCARE_SNAPSHOT_SIZE (TAMA_STATE_SIZE + TAMA_STATE_DISPLAY_SIZE)
+
+typedef enum {
+    TamaSpeedQuarter,
+    TamaSpeedHalf,
+    TamaSpeed1x,
+    TamaSpeed2x,
+    TamaSpeed4x,
+    TamaSpeed8x,
+    TamaSpeed16x,
+    TamaSpeed32x,
+    TamaSpeed64x,
+    TamaSpeedMax,
+    TamaSpeedNum,
+} TamaSpeed;
+
+typedef struct {
+    // The clock handed to TamaLIB runs at 1/slowdown of TIM2 for slow motion.
+    // Speed-ups are left to tamalib_set_speed.
+    uint32_t base;
+    uint32_t timer_base;
+    uint8_t slowdown;
+} TamaClock;
+
+typedef struct {
+    // TIM2 minus the emulated deadline, as of the last deadline. Deadlines chain
+    // from one step to the next, so this is the drift accumulated since the
+    // last sync; positive means the emulation is running behind.
+    int32_t drift;
+    int32_t drift_max;
+    uint32_t late_steps;
+    uint32_t bursts;
+    uint32_t sleeps;
+    uint32_t burst_len;
+} TamaSched;
+
+// TamaLIB callbacks made, TAMA_PROFILE_DIAG only
+typedef struct {
+    uint32_t lcd_matrix;
+    uint32_t lcd_icon;
+    uint32_t set_frequency;
+    uint32_t play_frequency;
+    uint32_t sleeps;
+    uint32_t logs;
+} TamaDiag;
+
+typedef struct {
+    bool active;
+    bool key; // Next frame is written in full
+    FuriThread* thread;
+    FuriStreamBuffer* stream;
+    File* file;
+    uint32_t framebuffer[16]; // Last frame handed to the stream
+    uint8_t icons;
+    uint32_t last_tick;
+    uint32_t frames;
+    uint32_t dropped;
+    uint32_t bytes;
+    uint8_t chunk[TAMA_CAPTURE_CHUNK];
+} TamaCapture;
+
+typedef enum {
+    TamaLowPowerHidden = 1 << 0, // Game view not shown, e.g. the menu is open
+    TamaLowPowerStatic = 1 << 1, // LCD unchanged for TAMA_LOWPOWER_STATIC_FRAMES
+} TamaLowPowerReason;
+
+typedef struct {
+    uint8_t reasons; // TamaLowPowerReason bits, low power while any is set
+    uint32_t since; // Kernel tick the current low power period started
+    uint32_t ticks; // Kernel ticks spent in low power, closed periods only
+    uint32_t slept; // Kernel ticks the worker blocked while in low power
+    uint32_t entries;
+    uint8_t static_frames;
+    uint32_t framebuffer[16]; // LCD as of the last update timer frame
+    uint8_t icons;
+} TamaLowPower;
+
+typedef struct {
+    uint8_t button;
+    bool pressed;
+} TamaInput;
+
+// Work the worker has to do between two steps, set and cleared under state_mutex
+typedef enum {
+    TamaWorkerEventExit = 1 << 0,
+    TamaWorkerEventInput = 1 << 1, // input_queue not empty
+    TamaWorkerEventReplay = 1 << 2, // Held while a movie replays
+    TamaWorkerEventBurst = 1 << 3, // Held while unthrottled
+    TamaWorkerEventDaycare = 1 << 4, // Held while more than one pet lives
+} TamaWorkerEvent;
 
 typedef struct {
+    uint8_t* snapshot; // TAMA_DAYCARE_SNAPSHOT_SIZE bytes once adopted, current while not shown
+    bool live;
+    // While not shown: the CPU tick the pet has to reach to be on time, and
+    // the kernel tick and remainder that is accounted up to
+    uint32_t target;
+    uint32_t since;
+    uint32_t carry;
+} TamaPet;
+
+typedef struct {
+    TamaPet pets[TAMA_DAYCARE_PETS];
+    uint8_t* reset; // TAMA_STATE_SIZE bytes as of tamalib_init, NULL without room for new pets
+    uint8_t shown; // The pet in the core outside of visits
+    uint8_t live;
+    uint8_t visit_left; // Pets the running visit has yet to catch up, one bit each
+    uint32_t next_visit; // Kernel tick
+    uint32_t visits;
+    uint32_t late; // Catch-ups that dropped time beyond TAMA_DAYCARE_VISIT_MAX
+} TamaDaycare;
+
+typedef enum {
+    TamaMovieModeOff,
+    TamaMovieModeRecord,
+    TamaMovieModeReplay,
+} TamaMovieMode;
+
+typedef struct {
+    TamaMovieMode mode;
+    File* file;
+    uint32_t last_tick;
+    uint32_t events;
+    TamaMovieEvent next;
+    uint8_t speed; // Restored once a replay ends
+} TamaMovie;
+
+typedef struct {
+    // Serves every allocation of the session, this struct included
+    TamaArena arena;
     FuriThread* thread;
     FuriTimer* timer;
+    FuriMutex* state_mutex;
+    FuriMutex* draw_mutex;
     hal_t hal;
+    hal_t hal_background; // Same without LCD and buzzer output, for pets not shown
+    bool background;
     uint8_t* rom;
+    uint8_t* scratch; // TAMA_MOVIE_HEADER_SIZE bytes for state and movie headers
     // 32x16 screen, perfectly represented through uint32_t
     uint32_t framebuffer[16];
     uint8_t icons;
+    bool lcd_dirty;
     bool halted;
     bool fast_forward_done;
-    bool buzzer_on;
-    float frequency;
+    FuriThread* audio_thread;
+    FuriMessageQueue* buzzer_queue;
+    uint32_t buzzer_dropped; // Events lost to a full buzzer_queue
+    TamaBuzzer buzzer;
     uint8_t cpu_speed;
     bool buzzer_mute;
+    bool buzzer_audible;
+    uint8_t frame_skip;
+    uint8_t frame_count;
+    TamaClock clock;
+    TamaSched sched;
+#ifdef TAMA_PROFILE_DIAG
+    TamaDiag diag;
+#endif
+    TamaLowPower low_power;
+    TamaCapture capture;
+    // Button changes wait here for the worker so they land between steps
+    TamaInput input_queue[TAMA_INPUT_QUEUE_SIZE];
+    uint8_t input_head;
+    uint8_t input_tail;
+    TamaMovie movie;
+    uint8_t worker_events; // TamaWorkerEvent bits
+    TamaDaycare daycare;
 } TamaApp;
 
 typedef enum {
@@ -39,8 +243,20 @@ typedef struct {
     InputEvent input;
 } TamaEvent;
 
+// The one running instance; TamaLIB's HAL callbacks carry no context of their own
 extern TamaApp* g_ctx;
-extern FuriMutex* g_state_mutex;
-extern FuriMutex* g_draw_mutex;
 
-void tama_p1_hal_init(hal_t* hal);
+void tama_p1_input_push(button_t button, btn_state_t state);
+// Switches the shown pet, with the state mutex held. False while a movie runs.
+bool tama_p1_daycare_show(uint8_t index);
+
+void tama_p1_hal_init(hal_t* hal, hal_t* background);
+// Swaps the core over to hal_background and unthrottled, or back
+void tama_p1_hal_background(bool background);
+void tama_p1_hal_set_speed(TamaSpeed speed);
+// Brings framebuffer and icons up to date with the display memory
+void tama_p1_hal_lcd_sync(void);
+void tama_p1_hal_low_power(TamaLowPowerReason reason, bool enabled);
+void tama_p1_hal_buzzer_sync(void);
+void tama_p1_hal_audio_start(void);
+void tama_p1_hal_audio_stop(void);
@@ -0,0 +1,31 @@
+#include <stdlib.h>
+#include <string.h>
+#include "tama_arena.h"
+
+void tama_arena_init(TamaArena* arena, size_t size) {
+    memset(arena, 0, sizeof(TamaArena));
+    arena->base = malloc(size);
+    if(arena->base != NULL) arena->size = size;
+}
+
+void tama_arena_release(TamaArena* arena) {
+    free(arena->base);
+    arena->base = NULL;
+    arena->size = 0;
+    arena->used = 0;
+}
+
+void* tama_arena_alloc(TamaArena* arena, size_t size) {
+    size = (size + TAMA_ARENA_ALIGN - 1) & ~(size_t)(TAMA_ARENA_ALIGN - 1);
+    if(size > arena->size - arena->used) {
+        arena->failed++;
+        return NULL;
+    }
+
+    void* ptr = arena->base + arena->used;
+    memset(ptr, 0, size);
+    arena->used += size;
+    if(arena->used > arena->peak) arena->peak = arena->used;
+    arena->allocs++;
+    return ptr;
+}
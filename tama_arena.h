@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TAMA_ARENA_ALIGN 8
+
+/*
+ * Bump allocator over one block: allocations are never freed on their own,
+ * the whole block goes back to the heap at once in tama_arena_release.
+ */
+typedef struct {
+    uint8_t* base;
+    size_t size;
+    size_t used;
+    size_t peak;
+    uint32_t allocs;
+    uint32_t failed;
+} TamaArena;
+
+void tama_arena_init(TamaArena* arena, size_t size);
+void tama_arena_release(TamaArena* arena);
+
+// Zeroed and TAMA_ARENA_ALIGN aligned, NULL once the block is exhausted
+void* tama_arena_alloc(TamaArena* arena, size_t size);
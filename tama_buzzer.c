@@ -0,0 +1,30 @@
+#include <string.h>
+#include "tama_buzzer.h"
+
+static bool tama_buzzer_update(TamaBuzzer* buzzer, uint32_t tick, TamaBuzzerEvent* event) {
+    uint32_t output = buzzer->enabled ? buzzer->frequency : TAMA_BUZZER_SILENT;
+    if(output == buzzer->output) return false;
+
+    buzzer->output = output;
+    event->tick = tick;
+    event->frequency = output;
+    return true;
+}
+
+void tama_buzzer_reset(TamaBuzzer* buzzer) {
+    memset(buzzer, 0, sizeof(TamaBuzzer));
+}
+
+bool tama_buzzer_set_frequency(
+    TamaBuzzer* buzzer,
+    uint32_t frequency,
+    uint32_t tick,
+    TamaBuzzerEvent* event) {
+    buzzer->frequency = frequency;
+    return tama_buzzer_update(buzzer, tick, event);
+}
+
+bool tama_buzzer_play(TamaBuzzer* buzzer, bool enabled, uint32_t tick, TamaBuzzerEvent* event) {
+    buzzer->enabled = enabled;
+    return tama_buzzer_update(buzzer, tick, event);
+}
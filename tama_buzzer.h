@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Frequencies are in tenths of Hz as handed over by TamaLIB, 0 is silence
+#define TAMA_BUZZER_SILENT 0
+
+typedef struct {
+    uint32_t tick; // CPU tick counter when the change happened
+    uint32_t frequency;
+} TamaBuzzerEvent;
+
+typedef struct {
+    bool enabled;
+    uint32_t frequency;
+    uint32_t output;
+} TamaBuzzer;
+
+void tama_buzzer_reset(TamaBuzzer* buzzer);
+
+/*
+ * Both return true and fill in event only when what can be heard changes, so
+ * a frequency change while silent or a repeated enable costs nothing.
+ */
+bool tama_buzzer_set_frequency(
+    TamaBuzzer* buzzer,
+    uint32_t frequency,
+    uint32_t tick,
+    TamaBuzzerEvent* event);
+bool tama_buzzer_play(TamaBuzzer* buzzer, bool enabled, uint32_t tick, TamaBuzzerEvent* event);
@@ -0,0 +1,75 @@
+#include <string.h>
+#include "tama_capture.h"
+
+static void tama_capture_put_u32(uint8_t* buf, uint32_t val) {
+    buf[0] = val & 0xFF;
+    buf[1] = (val >> 8) & 0xFF;
+    buf[2] = (val >> 16) & 0xFF;
+    buf[3] = (val >> 24) & 0xFF;
+}
+
+static uint32_t tama_capture_get_u32(const uint8_t* buf) {
+    return buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
+
+size_t tama_capture_header(uint8_t* buf) {
+    memcpy(buf, TAMA_CAPTURE_MAGIC, 4);
+    buf[4] = TAMA_CAPTURE_VERSION;
+    return TAMA_CAPTURE_HEADER_SIZE;
+}
+
+bool tama_capture_header_check(const uint8_t* buf, size_t size) {
+    return size >= TAMA_CAPTURE_HEADER_SIZE && memcmp(buf, TAMA_CAPTURE_MAGIC, 4) == 0 &&
+           buf[4] == TAMA_CAPTURE_VERSION;
+}
+
+size_t tama_capture_frame_encode(
+    uint8_t* buf,
+    uint32_t delta,
+    const uint32_t prev[16],
+    uint8_t prev_icons,
+    const uint32_t framebuffer[16],
+    uint8_t icons) {
+    uint8_t* ptr = buf + 7;
+    uint16_t rows = 0;
+
+    for(uint8_t row = 0; row < 16; row++) {
+        if(prev != NULL && prev[row] == framebuffer[row]) continue;
+        rows |= 1 << row;
+        tama_capture_put_u32(ptr, framebuffer[row]);
+        ptr += 4;
+    }
+    if(prev != NULL && rows == 0 && prev_icons == icons) return 0;
+
+    tama_capture_put_u32(buf, delta);
+    buf[4] = rows & 0xFF;
+    buf[5] = rows >> 8;
+    buf[6] = icons;
+    return ptr - buf;
+}
+
+size_t tama_capture_frame_decode(
+    const uint8_t* buf,
+    size_t size,
+    uint32_t* delta,
+    uint32_t framebuffer[16],
+    uint8_t* icons) {
+    if(size < 7) return 0;
+
+    uint16_t rows = buf[4] | (buf[5] << 8);
+    size_t len = 7;
+    for(uint8_t row = 0; row < 16; row++) {
+        if(rows & (1 << row)) len += 4;
+    }
+    if(size < len) return 0;
+
+    const uint8_t* ptr = buf + 7;
+    for(uint8_t row = 0; row < 16; row++) {
+        if(!(rows & (1 << row))) continue;
+        framebuffer[row] = tama_capture_get_u32(ptr);
+        ptr += 4;
+    }
+    *delta = tama_capture_get_u32(buf);
+    *icons = buf[6];
+    return len;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * LCD capture: magic and version, then one record per frame that differs from
+ * the previous one. A record holds the CPU ticks elapsed since the previous
+ * record (u32), a mask of the changed rows (u16), the icon bits (u8) and the
+ * 32 pixels of every changed row (u32 each), all little endian. The first
+ * record carries every row.
+ */
+#define TAMA_CAPTURE_MAGIC       "TLCP"
+#define TAMA_CAPTURE_VERSION     1
+#define TAMA_CAPTURE_HEADER_SIZE 5
+#define TAMA_CAPTURE_FRAME_MAX   (7 + 16 * 4)
+
+size_t tama_capture_header(uint8_t* buf);
+bool tama_capture_header_check(const uint8_t* buf, size_t size);
+
+/*
+ * Encodes framebuffer and icons against prev, the last frame written, or as a
+ * full frame when prev is NULL. Returns 0 when nothing changed.
+ */
+size_t tama_capture_frame_encode(
+    uint8_t* buf,
+    uint32_t delta,
+    const uint32_t prev[16],
+    uint8_t prev_icons,
+    const uint32_t framebuffer[16],
+    uint8_t icons);
+
+/*
+ * Applies one record on top of framebuffer and icons. Returns the bytes it
+ * took, or 0 if buf ends in the middle of it.
+ */
+size_t tama_capture_frame_decode(
+    const uint8_t* buf,
+    size_t size,
+    uint32_t* delta,
+    uint32_t framebuffer[16],
+    uint8_t* icons);
@@ -0,0 +1,48 @@
+#include "tama_lcd.h"
+
+#define TAMA_LCD_SEG_NUM 40
+
+/* SEG -> LCD column, mirrors seg_pos in TamaLIB's hw.c; 32 and up are icons */
+static const uint8_t seg_pos[TAMA_LCD_SEG_NUM] = {
+    0,  1,  2,  3,  4,  5,  6,  7,  32, 8,  9,  10, 11, 12, 13, 14, 15, 33, 34, 35,
+    31, 30, 29, 28, 27, 26, 25, 24, 36, 23, 22, 21, 20, 19, 18, 17, 16, 37, 38, 39,
+};
+
+static void
+    tama_lcd_decode_nibble(uint16_t n, uint8_t v, uint32_t framebuffer[16], uint8_t* icons) {
+    uint8_t seg = (n & 0x7F) >> 1;
+    uint8_t com0 = ((n & 0x80) >> 7) * 8 + (n & 0x1) * 4;
+
+    if(seg >= TAMA_LCD_SEG_NUM) return;
+
+    uint8_t x = seg_pos[seg];
+    if(x < LCD_WIDTH) {
+        for(uint8_t i = 0; i < 4; i++) {
+            if((v >> i) & 0x1) framebuffer[com0 + i] |= 1UL << x;
+        }
+    } else if(seg == 8 && com0 < 4) {
+        /* Icons 0-3 sit on SEG8 COM0-3, icons 4-7 on SEG28 COM12-15 */
+        *icons |= v;
+    } else if(seg == 28 && com0 >= 12) {
+        *icons |= v << 4;
+    }
+}
+
+void tama_lcd_decode(const MEM_BUFFER_TYPE* memory, uint32_t framebuffer[16], uint8_t* icons) {
+    uint8_t lcd_icons = 0;
+
+    for(uint8_t row = 0; row < LCD_HEIGHT; row++)
+        framebuffer[row] = 0;
+
+    for(uint16_t i = 0; i < MEM_DISPLAY1_SIZE; i++) {
+        uint16_t n = MEM_DISPLAY1_ADDR + i;
+        tama_lcd_decode_nibble(n, GET_DISP1_MEMORY(memory, n), framebuffer, &lcd_icons);
+    }
+
+    for(uint16_t i = 0; i < MEM_DISPLAY2_SIZE; i++) {
+        uint16_t n = MEM_DISPLAY2_ADDR + i;
+        tama_lcd_decode_nibble(n, GET_DISP2_MEMORY(memory, n), framebuffer, &lcd_icons);
+    }
+
+    *icons = lcd_icons;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdint.h>
+#include <tamalib.h>
+
+/*
+ * Rebuilds the 32x16 matrix rows and the icon bits straight from the display
+ * memory, the same way TamaLIB turns display memory writes into
+ * set_lcd_matrix/set_lcd_icon calls. Lets the HAL skip those per pixel calls
+ * (TAMA_LCD_LAZY) and decode only when a frame is actually drawn.
+ */
+void tama_lcd_decode(const MEM_BUFFER_TYPE* memory, uint32_t framebuffer[16], uint8_t* icons);
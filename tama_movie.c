@@ -0,0 +1,39 @@
+#include "tama_movie.h"
+
+size_t tama_movie_header_save(uint8_t* buf) {
+    for(size_t i = 0; i < 4; i++)
+        buf[i] = (uint8_t)TAMA_MOVIE_MAGIC[i];
+    buf[4] = TAMA_MOVIE_VERSION;
+
+    return 5 + tama_state_save(&buf[5]);
+}
+
+bool tama_movie_header_load(const uint8_t* buf, size_t size) {
+    if(size < TAMA_MOVIE_HEADER_SIZE) return false;
+    for(size_t i = 0; i < 4; i++) {
+        if(buf[i] != (uint8_t)TAMA_MOVIE_MAGIC[i]) return false;
+    }
+    if(buf[4] != TAMA_MOVIE_VERSION) return false;
+
+    return tama_state_load(&buf[5], size - 5);
+}
+
+void tama_movie_event_encode(const TamaMovieEvent* event, uint8_t* buf) {
+    buf[0] = event->delta & 0xFF;
+    buf[1] = (event->delta >> 8) & 0xFF;
+    buf[2] = (event->delta >> 16) & 0xFF;
+    buf[3] = (event->delta >> 24) & 0xFF;
+    buf[4] = event->button == TAMA_MOVIE_END ? TAMA_MOVIE_END :
+                                               (event->button << 1) | (event->pressed ? 1 : 0);
+}
+
+void tama_movie_event_decode(const uint8_t* buf, TamaMovieEvent* event) {
+    event->delta = buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t)buf[3] << 24);
+    if(buf[4] == TAMA_MOVIE_END) {
+        event->button = TAMA_MOVIE_END;
+        event->pressed = false;
+    } else {
+        event->button = buf[4] >> 1;
+        event->pressed = buf[4] & 1;
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "tama_state.h"
+
+/*
+ * Input movie: magic, version and the state to start from, followed by button
+ * transitions stamped with the CPU ticks elapsed since the previous one. The
+ * last record is a TAMA_MOVIE_END marker at the tick recording stopped.
+ * Transitions are applied between steps, so replaying from the same state
+ * lands on exactly the same instruction boundaries. Gaps between records must
+ * stay below the 32-bit tick counter wrap (about 36 emulated hours).
+ */
+#define TAMA_MOVIE_MAGIC       "TLMV"
+#define TAMA_MOVIE_VERSION     1
+#define TAMA_MOVIE_HEADER_SIZE (5 + TAMA_STATE_SIZE)
+#define TAMA_MOVIE_EVENT_SIZE  5
+#define TAMA_MOVIE_END         0xFF
+
+typedef struct {
+    uint32_t delta;
+    uint8_t button; // button_t, or TAMA_MOVIE_END
+    bool pressed;
+} TamaMovieEvent;
+
+// Writes TAMA_MOVIE_HEADER_SIZE bytes capturing the current CPU state
+size_t tama_movie_header_save(uint8_t* buf);
+// Checks the header and restores the CPU state it holds
+bool tama_movie_header_load(const uint8_t* buf, size_t size);
+
+void tama_movie_event_encode(const TamaMovieEvent* event, uint8_t* buf);
+void tama_movie_event_decode(const uint8_t* buf, TamaMovieEvent* event);
@@ -28,8 +28,10 @@ TamaApp* g_ctx;
 TamaMode g_mode;
 FuriString* g_rom_path;
 FuriString* g_sav_path;
-FuriMutex* g_state_mutex;
-FuriMutex* g_draw_mutex;
+FuriString* g_mov_path;
+FuriString* g_cap_path;
+FuriString* g_pet_paths[TAMA_DAYCARE_PETS]; // From pet 1 on, pet 0 uses g_sav_path
+static TamaMenu* g_menu;
 
 static bool tama_p1_navigation_callback(void* callback) {
     furi_assert(callback);
@@ -40,267 +42,687 @@ static bool tama_p1_navigation_callback(void* callback) {
     return true;
 }
 
+static void tama_p1_capture_frame() {
+    // Timer thread, with the draw mutex held: the emulation thread never waits
+    // on the capture, and the SD card is only touched by the capture thread.
+    TamaCapture* capture = &g_ctx->capture;
+    uint8_t buf[TAMA_CAPTURE_FRAME_MAX];
+    uint32_t tick = *tamalib_get_state()->tick_counter;
+    size_t size = tama_capture_frame_encode(
+        buf,
+        tick - capture->last_tick,
+        capture->key ? NULL : capture->framebuffer,
+        capture->icons,
+        g_ctx->framebuffer,
+        g_ctx->icons);
+    if(size == 0) return;
+
+    // Single writer, so the space can only grow before the send. A dropped
+    // frame is simply folded into the next one, which is encoded against the
+    // last frame that made it.
+    if(furi_stream_buffer_spaces_available(capture->stream) < size) {
+        capture->dropped++;
+        return;
+    }
+    furi_stream_send(capture->stream, buf, size, 0);
+
+    memcpy(capture->framebuffer, g_ctx->framebuffer, sizeof(capture->framebuffer));
+    capture->icons = g_ctx->icons;
+    capture->last_tick = tick;
+    capture->key = false;
+    capture->frames++;
+}
+
 static void tama_p1_update_timer_callback(void* callback) {
     furi_assert(callback);
 
     View* view = callback;
+    TamaLowPower* low_power = &g_ctx->low_power;
+
+    // A blank (asleep at night) or otherwise static LCD needs no redraws
+    if(furi_mutex_acquire(g_ctx->draw_mutex, 0) == FuriStatusOk) {
+        tama_p1_hal_lcd_sync();
+        if(g_ctx->capture.active) tama_p1_capture_frame();
+        if(memcmp(low_power->framebuffer, g_ctx->framebuffer, sizeof(g_ctx->framebuffer)) ||
+           low_power->icons != g_ctx->icons) {
+            memcpy(low_power->framebuffer, g_ctx->framebuffer, sizeof(g_ctx->framebuffer));
+            low_power->icons = g_ctx->icons;
+            if(low_power->static_frames >= TAMA_LOWPOWER_STATIC_FRAMES)
+                tama_p1_hal_low_power(TamaLowPowerStatic, false);
+            low_power->static_frames = 0;
+        } else if(low_power->static_frames < TAMA_LOWPOWER_STATIC_FRAMES) {
+            if(++low_power->static_frames == TAMA_LOWPOWER_STATIC_FRAMES)
+                tama_p1_hal_low_power(TamaLowPowerStatic, true);
+        }
+        furi_mutex_release(g_ctx->draw_mutex);
+    }
+    if(low_power->static_frames >= TAMA_LOWPOWER_STATIC_FRAMES) return;
+
+    // Above 1x nobody can follow every LCD frame, leave the time to the CPU core
+    if(++g_ctx->frame_count < g_ctx->frame_skip) return;
+    g_ctx->frame_count = 0;
     view_commit_model(view, true);
 }
 
+static FuriString* tama_p1_pet_path(uint8_t index) {
+    return index == 0 ? g_sav_path : g_pet_paths[index];
+}
+
 static void tama_p1_load_state() {
-    state_t* state;
-    uint8_t buf[4];
-    bool error = false;
-    state = tamalib_get_state();
+    FuriString* path = tama_p1_pet_path(g_ctx->daycare.shown);
 
-    if(g_sav_path == NULL) return;
-    if(furi_mutex_acquire(g_state_mutex, FuriWaitForever) != FuriStatusOk) return;
+    if(path == NULL) return;
+    if(furi_mutex_acquire(g_ctx->state_mutex, FuriWaitForever) != FuriStatusOk) return;
 
     Storage* storage = furi_record_open(RECORD_STORAGE);
     File* file = storage_file_alloc(storage);
-    if(storage_file_open(file, furi_string_get_cstr(g_sav_path), FSAM_READ, FSOM_OPEN_EXISTING)) {
-        storage_file_read(file, &buf, 4);
-        if(buf[0] != (uint8_t)STATE_FILE_MAGIC[0] || buf[1] != (uint8_t)STATE_FILE_MAGIC[1] ||
-           buf[2] != (uint8_t)STATE_FILE_MAGIC[2] || buf[3] != (uint8_t)STATE_FILE_MAGIC[3]) {
+    if(storage_file_open(file, furi_string_get_cstr(path), FSAM_READ, FSOM_OPEN_EXISTING)) {
+        FURI_LOG_D(TAG, "Reading save.bin");
+        uint8_t* buf = g_ctx->scratch;
+        size_t size = storage_file_read(file, buf, TAMA_STATE_SIZE);
+        if(!tama_state_load(buf, size)) {
             FURI_LOG_E(
                 TAG,
-                "FATAL: Wrong state file magic in \"%s\" !\n",
-                furi_string_get_cstr(g_sav_path));
-            error = true;
+                "FATAL: Wrong state file magic, version or size in \"%s\" !\n",
+                furi_string_get_cstr(path));
         }
+    }
+
+    storage_file_close(file);
+    storage_file_free(file);
+    furi_record_close(RECORD_STORAGE);
+    furi_mutex_release(g_ctx->state_mutex);
+}
+
+static void tama_p1_save_state() {
+    // Saving state
+    FURI_LOG_D(TAG, "Saving Gamestate");
+
+    if(furi_mutex_acquire(g_ctx->state_mutex, FuriWaitForever) != FuriStatusOk) return;
+
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+
+    for(uint8_t i = 0; i < TAMA_DAYCARE_PETS; i++) {
+        TamaPet* pet = &g_ctx->daycare.pets[i];
+        FuriString* path = tama_p1_pet_path(i);
+        size_t offset = 0;
+
+        if(!pet->live || path == NULL) continue;
 
-        storage_file_read(file, &buf, 1);
-        if(buf[0] != STATE_FILE_VERSION) {
-            FURI_LOG_E(TAG, "FATAL: Unsupported version");
-            error = true;
+        // The shown pet is in the core, the others in their snapshots
+        uint8_t* buf = pet->snapshot;
+        if(i == g_ctx->daycare.shown) {
+            buf = g_ctx->scratch;
+            tama_state_save(buf);
         }
-        if(!error) {
-            FURI_LOG_D(TAG, "Reading save.bin");
 
-            storage_file_read(file, &buf, 2);
-            *(state->pc) = buf[0] | ((buf[1] & 0x1F) << 8);
+        File* file = storage_file_alloc(storage);
+        if(storage_file_open(file, furi_string_get_cstr(path), FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
+            offset = storage_file_write(file, buf, TAMA_STATE_SIZE);
+        }
+        storage_file_close(file);
+        storage_file_free(file);
 
-            storage_file_read(file, &buf, 2);
-            *(state->x) = buf[0] | ((buf[1] & 0xF) << 8);
+        FURI_LOG_D(TAG, "Finished Writing %u", offset);
+    }
 
-            storage_file_read(file, &buf, 2);
-            *(state->y) = buf[0] | ((buf[1] & 0xF) << 8);
+    furi_record_close(RECORD_STORAGE);
+    furi_mutex_release(g_ctx->state_mutex);
+}
 
-            storage_file_read(file, &buf, 1);
-            *(state->a) = buf[0] & 0xF;
+static void tama_p1_movie_close() {
+    TamaMovie* movie = &g_ctx->movie;
 
-            storage_file_read(file, &buf, 1);
-            *(state->b) = buf[0] & 0xF;
+    storage_file_close(movie->file);
+    storage_file_free(movie->file);
+    furi_record_close(RECORD_STORAGE);
+    movie->file = NULL;
+    movie->mode = TamaMovieModeOff;
+    g_ctx->worker_events &= ~TamaWorkerEventReplay;
+}
 
-            storage_file_read(file, &buf, 1);
-            *(state->np) = buf[0] & 0x1F;
+static bool tama_p1_movie_open(FS_AccessMode access_mode, FS_OpenMode open_mode) {
+    TamaMovie* movie = &g_ctx->movie;
 
-            storage_file_read(file, &buf, 1);
-            *(state->sp) = buf[0];
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    movie->file = storage_file_alloc(storage);
+    if(!storage_file_open(movie->file, furi_string_get_cstr(g_mov_path), access_mode, open_mode)) {
+        FURI_LOG_E(TAG, "Cannot open \"%s\"", furi_string_get_cstr(g_mov_path));
+        tama_p1_movie_close();
+        return false;
+    }
 
-            storage_file_read(file, &buf, 1);
-            *(state->flags) = buf[0] & 0xF;
+    return true;
+}
 
-            storage_file_read(file, &buf, 4);
-            *(state->tick_counter) = buf[0] | (buf[1] << 8) | (buf[2] << 16) | (buf[3] << 24);
+static void tama_p1_movie_write(uint8_t button, bool pressed) {
+    TamaMovie* movie = &g_ctx->movie;
+    uint32_t tick = *tamalib_get_state()->tick_counter;
+    TamaMovieEvent event = {
+        .delta = tick - movie->last_tick,
+        .button = button,
+        .pressed = pressed,
+    };
+    uint8_t buf[TAMA_MOVIE_EVENT_SIZE];
+
+    tama_movie_event_encode(&event, buf);
+    storage_file_write(movie->file, buf, sizeof(buf));
+    movie->last_tick = tick;
+    movie->events++;
+}
 
-            storage_file_read(file, &buf, 4);
-            *(state->clk_timer_timestamp) = buf[0] | (buf[1] << 8) | (buf[2] << 16) |
-                                            (buf[3] << 24);
+static bool tama_p1_movie_read() {
+    TamaMovie* movie = &g_ctx->movie;
+    uint8_t buf[TAMA_MOVIE_EVENT_SIZE];
 
-            storage_file_read(file, &buf, 4);
-            *(state->prog_timer_timestamp) = buf[0] | (buf[1] << 8) | (buf[2] << 16) |
-                                             (buf[3] << 24);
+    if(storage_file_read(movie->file, buf, sizeof(buf)) != sizeof(buf)) return false;
+    tama_movie_event_decode(buf, &movie->next);
+    return true;
+}
 
-            storage_file_read(file, &buf, 1);
-            *(state->prog_timer_enabled) = buf[0] & 0x1;
+static void tama_p1_movie_record_start() {
+    TamaMovie* movie = &g_ctx->movie;
 
-            storage_file_read(file, &buf, 1);
-            *(state->prog_timer_data) = buf[0];
+    if(g_mov_path == NULL) return;
+    if(furi_mutex_acquire(g_ctx->state_mutex, FuriWaitForever) != FuriStatusOk) return;
 
-            storage_file_read(file, &buf, 1);
-            *(state->prog_timer_rld) = buf[0];
+    if(movie->mode == TamaMovieModeOff &&
+       tama_p1_movie_open(FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
+        uint8_t* buf = g_ctx->scratch;
+        storage_file_write(movie->file, buf, tama_movie_header_save(buf));
 
-            storage_file_read(file, &buf, 4);
-            *(state->call_depth) = buf[0] | (buf[1] << 8) | (buf[2] << 16) | (buf[3] << 24);
+        movie->mode = TamaMovieModeRecord;
+        movie->last_tick = *tamalib_get_state()->tick_counter;
+        movie->events = 0;
+        FURI_LOG_I(TAG, "Recording to \"%s\"", furi_string_get_cstr(g_mov_path));
+    }
 
-            FURI_LOG_D(TAG, "Restoring Interupts");
-            for(uint32_t i = 0; i < INT_SLOT_NUM; i++) {
-                storage_file_read(file, &buf, 1);
-                state->interrupts[i].factor_flag_reg = buf[0] & 0xF;
+    furi_mutex_release(g_ctx->state_mutex);
+}
 
-                storage_file_read(file, &buf, 1);
-                state->interrupts[i].mask_reg = buf[0] & 0xF;
+static void tama_p1_movie_record_stop() {
+    TamaMovie* movie = &g_ctx->movie;
 
-                storage_file_read(file, &buf, 1);
-                state->interrupts[i].triggered = buf[0] & 0x1;
-            }
+    if(furi_mutex_acquire(g_ctx->state_mutex, FuriWaitForever) != FuriStatusOk) return;
 
-            /* First 640 half bytes correspond to the RAM */
-            FURI_LOG_D(TAG, "Restoring RAM");
-            for(uint32_t i = 0; i < MEM_RAM_SIZE; i++) {
-                storage_file_read(file, &buf, 1);
-                SET_RAM_MEMORY(state->memory, i + MEM_RAM_ADDR, buf[0] & 0xF);
-            }
+    if(movie->mode == TamaMovieModeRecord) {
+        tama_p1_movie_write(TAMA_MOVIE_END, false);
+        FURI_LOG_I(TAG, "Recorded %lu input events", movie->events - 1);
+        tama_p1_movie_close();
+    }
 
-            /* I/Os are from 0xF00 to 0xF7F */
-            FURI_LOG_D(TAG, "Restoring I/O");
-            for(uint32_t i = 0; i < MEM_IO_SIZE; i++) {
-                storage_file_read(file, &buf, 1);
-                SET_IO_MEMORY(state->memory, i + MEM_IO_ADDR, buf[0] & 0xF);
-            }
-            FURI_LOG_D(TAG, "Refreshing Hardware");
-            tamalib_refresh_hw();
+    furi_mutex_release(g_ctx->state_mutex);
+}
+
+static void tama_p1_movie_replay_stop() {
+    TamaMovie* movie = &g_ctx->movie;
+
+    FURI_LOG_I(TAG, "Replayed %lu input events", movie->events);
+    tama_p1_movie_close();
+    tama_p1_hal_set_speed(movie->speed);
+}
+
+static void tama_p1_movie_replay_start() {
+    TamaMovie* movie = &g_ctx->movie;
+
+    if(g_mov_path == NULL) return;
+    if(furi_mutex_acquire(g_ctx->state_mutex, FuriWaitForever) != FuriStatusOk) return;
+
+    if(movie->mode == TamaMovieModeOff && tama_p1_movie_open(FSAM_READ, FSOM_OPEN_EXISTING)) {
+        uint8_t* buf = g_ctx->scratch;
+        size_t size = storage_file_read(movie->file, buf, TAMA_MOVIE_HEADER_SIZE);
+        bool loaded = tama_movie_header_load(buf, size);
+
+        if(loaded && tama_p1_movie_read()) {
+            movie->mode = TamaMovieModeReplay;
+            g_ctx->worker_events |= TamaWorkerEventReplay;
+            movie->last_tick = *tamalib_get_state()->tick_counter;
+            movie->events = 0;
+            movie->speed = g_ctx->cpu_speed;
+            // Drop live input still waiting from before the replay
+            g_ctx->input_tail = g_ctx->input_head;
+            tama_p1_hal_set_speed(TamaSpeedMax);
+            FURI_LOG_I(TAG, "Replaying \"%s\"", furi_string_get_cstr(g_mov_path));
+        } else {
+            FURI_LOG_E(TAG, "Invalid movie \"%s\"", furi_string_get_cstr(g_mov_path));
+            tama_p1_movie_close();
         }
     }
 
-    storage_file_close(file);
-    storage_file_free(file);
-    furi_record_close(RECORD_STORAGE);
-    furi_mutex_release(g_state_mutex);
+    furi_mutex_release(g_ctx->state_mutex);
 }
 
-static void tama_p1_save_state() {
-    // Saving state
-    FURI_LOG_D(TAG, "Saving Gamestate");
+static int32_t tama_p1_capture_worker(void* context) {
+    TamaCapture* capture = context;
+
+    // Keeps draining after the exit flag until the stream is empty
+    while(true) {
+        size_t size =
+            furi_stream_receive(capture->stream, capture->chunk, TAMA_CAPTURE_CHUNK, 250);
+        if(size > 0) {
+            capture->bytes += storage_file_write(capture->file, capture->chunk, size);
+        } else if(furi_thread_flags_get() & TAMA_WORKER_FLAG_EXIT) {
+            break;
+        }
+    }
 
-    uint8_t buf[4];
-    state_t* state;
-    uint32_t offset = 0;
-    state = tamalib_get_state();
+    return 0;
+}
 
-    if(g_sav_path == NULL) return;
-    if(furi_mutex_acquire(g_state_mutex, FuriWaitForever) != FuriStatusOk) return;
+static void tama_p1_capture_start() {
+    TamaCapture* capture = &g_ctx->capture;
+
+    if(g_cap_path == NULL || capture->active) return;
 
     Storage* storage = furi_record_open(RECORD_STORAGE);
-    File* file = storage_file_alloc(storage);
+    capture->file = storage_file_alloc(storage);
+    if(!storage_file_open(
+           capture->file, furi_string_get_cstr(g_cap_path), FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
+        FURI_LOG_E(TAG, "Cannot open \"%s\"", furi_string_get_cstr(g_cap_path));
+        storage_file_free(capture->file);
+        furi_record_close(RECORD_STORAGE);
+        capture->file = NULL;
+        return;
+    }
 
-    if(storage_file_open(file, furi_string_get_cstr(g_sav_path), FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
-        buf[0] = (uint8_t)STATE_FILE_MAGIC[0];
-        buf[1] = (uint8_t)STATE_FILE_MAGIC[1];
-        buf[2] = (uint8_t)STATE_FILE_MAGIC[2];
-        buf[3] = (uint8_t)STATE_FILE_MAGIC[3];
-        offset += storage_file_write(file, &buf, sizeof(buf));
+    uint8_t header[TAMA_CAPTURE_HEADER_SIZE];
+    capture->bytes = storage_file_write(capture->file, header, tama_capture_header(header));
+    capture->stream = furi_stream_buffer_alloc(TAMA_CAPTURE_STREAM_SIZE, TAMA_CAPTURE_CHUNK);
+
+    capture->thread = furi_thread_alloc();
+    furi_thread_set_name(capture->thread, "TamaCapture");
+    furi_thread_set_stack_size(capture->thread, 1024);
+    furi_thread_set_callback(capture->thread, tama_p1_capture_worker);
+    furi_thread_set_context(capture->thread, capture);
+    furi_thread_start(capture->thread);
+
+    furi_mutex_acquire(g_ctx->draw_mutex, FuriWaitForever);
+    capture->key = true;
+    capture->last_tick = *tamalib_get_state()->tick_counter;
+    capture->frames = 0;
+    capture->dropped = 0;
+    capture->active = true;
+    furi_mutex_release(g_ctx->draw_mutex);
+    FURI_LOG_I(TAG, "Capturing screen to \"%s\"", furi_string_get_cstr(g_cap_path));
+}
 
-        buf[0] = STATE_FILE_VERSION & 0xFF;
-        offset += storage_file_write(file, &buf, 1);
+static void tama_p1_capture_stop() {
+    TamaCapture* capture = &g_ctx->capture;
 
-        buf[0] = *(state->pc) & 0xFF;
-        buf[1] = (*(state->pc) >> 8) & 0x1F;
-        offset += storage_file_write(file, &buf, 2);
+    if(!capture->active) return;
 
-        buf[0] = *(state->x) & 0xFF;
-        buf[1] = (*(state->x) >> 8) & 0xF;
-        offset += storage_file_write(file, &buf, 2);
+    furi_mutex_acquire(g_ctx->draw_mutex, FuriWaitForever);
+    capture->active = false;
+    furi_mutex_release(g_ctx->draw_mutex);
 
-        buf[0] = *(state->y) & 0xFF;
-        buf[1] = (*(state->y) >> 8) & 0xF;
-        offset += storage_file_write(file, &buf, 2);
+    furi_thread_flags_set(furi_thread_get_id(capture->thread), TAMA_WORKER_FLAG_EXIT);
+    furi_thread_join(capture->thread);
+    furi_thread_free(capture->thread);
+    furi_stream_buffer_free(capture->stream);
+    capture->thread = NULL;
+    capture->stream = NULL;
 
-        buf[0] = *(state->a) & 0xF;
-        offset += storage_file_write(file, &buf, 1);
+    storage_file_close(capture->file);
+    storage_file_free(capture->file);
+    furi_record_close(RECORD_STORAGE);
+    capture->file = NULL;
+
+    FURI_LOG_I(
+        TAG,
+        "Captured %lu frames, %lu bytes, %lu dropped",
+        capture->frames,
+        capture->bytes,
+        capture->dropped);
+}
 
-        buf[0] = *(state->b) & 0xF;
-        offset += storage_file_write(file, &buf, 1);
+static void tama_p1_movie_replay_step() {
+    TamaMovie* movie = &g_ctx->movie;
+    uint32_t tick = *tamalib_get_state()->tick_counter;
+
+    // Recording stamped each event with the tick at a step boundary, so from the
+    // same state this fires at the very same boundary.
+    while((uint32_t)(tick - movie->last_tick) >= movie->next.delta) {
+        movie->last_tick += movie->next.delta;
+        if(movie->next.button == TAMA_MOVIE_END) {
+            tama_p1_movie_replay_stop();
+            return;
+        }
 
-        buf[0] = *(state->np) & 0x1F;
-        offset += storage_file_write(file, &buf, 1);
+        tamalib_set_button(
+            movie->next.button, movie->next.pressed ? BTN_STATE_PRESSED : BTN_STATE_RELEASED);
+        movie->events++;
 
-        buf[0] = *(state->sp) & 0xFF;
-        offset += storage_file_write(file, &buf, 1);
+        if(!tama_p1_movie_read()) {
+            FURI_LOG_E(TAG, "Movie ended without end marker");
+            tama_p1_movie_replay_stop();
+            return;
+        }
+    }
+}
 
-        buf[0] = *(state->flags) & 0xF;
-        offset += storage_file_write(file, &buf, 1);
+void tama_p1_input_push(button_t button, btn_state_t state) {
+    // Called with the state mutex held
+    if(g_ctx->movie.mode == TamaMovieModeReplay) return;
+    if((uint8_t)(g_ctx->input_head - g_ctx->input_tail) >= TAMA_INPUT_QUEUE_SIZE) return;
 
-        buf[0] = *(state->tick_counter) & 0xFF;
-        buf[1] = (*(state->tick_counter) >> 8) & 0xFF;
-        buf[2] = (*(state->tick_counter) >> 16) & 0xFF;
-        buf[3] = (*(state->tick_counter) >> 24) & 0xFF;
-        offset += storage_file_write(file, &buf, sizeof(buf));
+    TamaInput* input = &g_ctx->input_queue[g_ctx->input_head % TAMA_INPUT_QUEUE_SIZE];
+    input->button = button;
+    input->pressed = state == BTN_STATE_PRESSED;
+    g_ctx->input_head++;
+    g_ctx->worker_events |= TamaWorkerEventInput;
 
-        buf[0] = *(state->clk_timer_timestamp) & 0xFF;
-        buf[1] = (*(state->clk_timer_timestamp) >> 8) & 0xFF;
-        buf[2] = (*(state->clk_timer_timestamp) >> 16) & 0xFF;
-        buf[3] = (*(state->clk_timer_timestamp) >> 24) & 0xFF;
-        offset += storage_file_write(file, &buf, sizeof(buf));
+    if(g_ctx->low_power.reasons & TamaLowPowerStatic) {
+        g_ctx->low_power.static_frames = 0;
+        tama_p1_hal_low_power(TamaLowPowerStatic, false);
+    }
+    if(g_ctx->thread)
+        furi_thread_flags_set(furi_thread_get_id(g_ctx->thread), TAMA_WORKER_FLAG_WAKE);
+}
 
-        buf[0] = *(state->prog_timer_timestamp) & 0xFF;
-        buf[1] = (*(state->prog_timer_timestamp) >> 8) & 0xFF;
-        buf[2] = (*(state->prog_timer_timestamp) >> 16) & 0xFF;
-        buf[3] = (*(state->prog_timer_timestamp) >> 24) & 0xFF;
-        offset += storage_file_write(file, &buf, sizeof(buf));
+static void tama_p1_input_apply() {
+    while(g_ctx->input_tail != g_ctx->input_head) {
+        TamaInput* input = &g_ctx->input_queue[g_ctx->input_tail % TAMA_INPUT_QUEUE_SIZE];
+        tamalib_set_button(input->button, input->pressed ? BTN_STATE_PRESSED : BTN_STATE_RELEASED);
+        if(g_ctx->movie.mode == TamaMovieModeRecord)
+            tama_p1_movie_write(input->button, input->pressed);
+        g_ctx->input_tail++;
+    }
+    g_ctx->worker_events &= ~TamaWorkerEventInput;
+}
+
+// Snapshots come from the arena as pets move in, see tama_p1_daycare_budget.
+// The arena has no lock of its own, so this runs under state_mutex.
+static bool tama_p1_daycare_room(TamaPet* pet) {
+    if(pet->snapshot == NULL)
+        pet->snapshot = tama_arena_alloc(&g_ctx->arena, TAMA_DAYCARE_SNAPSHOT_SIZE);
+    return pet->snapshot != NULL;
+}
+
+static void tama_p1_daycare_park(TamaPet* pet) {
+    tama_state_save(pet->snapshot);
+    tama_state_save_display(pet->snapshot + TAMA_STATE_SIZE);
+}
 
-        buf[0] = *(state->prog_timer_enabled) & 0x1;
-        offset += storage_file_write(file, &buf, 1);
+static void tama_p1_daycare_unpark(TamaPet* pet) {
+    tama_state_load_display(pet->snapshot + TAMA_STATE_SIZE);
+    tama_state_load(pet->snapshot, TAMA_STATE_SIZE);
+}
+
+// Parks the pet in the core, which is on time as of now
+static void tama_p1_daycare_leave(TamaPet* pet, uint32_t now) {
+    pet->target = *tamalib_get_state()->tick_counter;
+    pet->since = now;
+    pet->carry = 0;
+    tama_p1_daycare_park(pet);
+}
 
-        buf[0] = *(state->prog_timer_data) & 0xFF;
-        offset += storage_file_write(file, &buf, 1);
+// Takes in a pet from a buffer in the save file format, with the core in the
+// background. The pet is left in the core as well.
+static bool tama_p1_daycare_adopt(uint8_t index, const uint8_t* buf, size_t size, uint32_t now) {
+    TamaDaycare* daycare = &g_ctx->daycare;
+    TamaPet* pet = &daycare->pets[index];
 
-        buf[0] = *(state->prog_timer_rld) & 0xFF;
-        offset += storage_file_write(file, &buf, 1);
+    // Blank until the ROM draws, rather than whatever the last pet showed
+    memset(pet->snapshot + TAMA_STATE_SIZE, 0, TAMA_STATE_DISPLAY_SIZE);
+    tama_state_load_display(pet->snapshot + TAMA_STATE_SIZE);
+    if(!tama_state_load(buf, size)) return false;
+
+    tama_p1_daycare_leave(pet, now);
+    pet->live = true;
+    if(++daycare->live > 1) g_ctx->worker_events |= TamaWorkerEventDaycare;
+    return true;
+}
 
-        buf[0] = *(state->call_depth) & 0xFF;
-        buf[1] = (*(state->call_depth) >> 8) & 0xFF;
-        buf[2] = (*(state->call_depth) >> 16) & 0xFF;
-        buf[3] = (*(state->call_depth) >> 24) & 0xFF;
-        offset += storage_file_write(file, &buf, sizeof(buf));
+// Runs the unparked pet unthrottled toward the time since it was last in the
+// core, taking the steps from *steps. Returns true once it has made up for it.
+static bool tama_p1_daycare_catch_up(TamaPet* pet, uint32_t now, uint32_t* steps) {
+    TamaDaycare* daycare = &g_ctx->daycare;
+    const u32_t* tick_counter = tamalib_get_state()->tick_counter;
+    uint32_t freq = furi_kernel_get_tick_frequency();
+
+    uint64_t owed = (uint64_t)(now - pet->since) * TICK_FREQUENCY + pet->carry;
+    pet->target += owed / freq;
+    pet->carry = owed % freq;
+    pet->since = now;
+
+    // Behind by more than a visit can make up, the pet skips the rest
+    uint32_t behind = pet->target - *tick_counter;
+    if((int32_t)behind > TAMA_DAYCARE_VISIT_MAX) {
+        pet->target -= behind - TAMA_DAYCARE_VISIT_MAX;
+        daycare->late++;
+        FURI_LOG_W(
+            TAG,
+            "Pet %u dropped %lu ms",
+            (unsigned)(pet - daycare->pets) + 1,
+            (uint32_t)((uint64_t)(behind - TAMA_DAYCARE_VISIT_MAX) * 1000 / TICK_FREQUENCY));
+    }
 
-        for(uint32_t i = 0; i < INT_SLOT_NUM; i++) {
-            buf[0] = state->interrupts[i].factor_flag_reg & 0xF;
-            offset += storage_file_write(file, &buf, 1);
+    while((int32_t)(*tick_counter - pet->target) < 0 && !g_ctx->halted) {
+        if(*steps == 0) return false;
+        (*steps)--;
+        tamalib_step();
+    }
+    return true;
+}
 
-            buf[0] = state->interrupts[i].mask_reg & 0xF;
-            offset += storage_file_write(file, &buf, 1);
+// Runs one burst of the visit due or under way, with the shown pet back in the
+// core after it. Returns true once the visit is over.
+static bool tama_p1_daycare_visit() {
+    TamaDaycare* daycare = &g_ctx->daycare;
+    TamaPet* shown = &daycare->pets[daycare->shown];
+    uint32_t now = furi_get_tick();
+    uint32_t steps = TAMA_SCHED_BURST_MAX;
+
+    if(daycare->visit_left == 0) {
+        daycare->next_visit = now + furi_ms_to_ticks(TAMA_DAYCARE_PERIOD_MS);
+        daycare->visits++;
+        for(uint8_t i = 0; i < TAMA_DAYCARE_PETS; i++)
+            if(daycare->pets[i].live) daycare->visit_left |= 1 << i;
+    }
 
-            buf[0] = state->interrupts[i].triggered & 0x1;
-            offset += storage_file_write(file, &buf, 1);
+    tama_p1_hal_background(true);
+    tama_p1_daycare_park(shown);
+    for(uint8_t i = 0; i < TAMA_DAYCARE_PETS; i++) {
+        TamaPet* pet = &daycare->pets[i];
+        if(!(daycare->visit_left & (1 << i))) continue;
+
+        // The shown pet may have changed in between two bursts
+        if(pet != shown) {
+            tama_p1_daycare_unpark(pet);
+            bool done = tama_p1_daycare_catch_up(pet, now, &steps);
+            tama_p1_daycare_park(pet);
+            if(!done) break;
         }
+        daycare->visit_left &= ~(1 << i);
+    }
+    tama_p1_daycare_unpark(shown);
+    tama_p1_hal_background(false);
+    return daycare->visit_left == 0;
+}
+
+// Pet 0 is in the core already, brings in the others that have a save file
+static void tama_p1_daycare_start() {
+    TamaDaycare* daycare = &g_ctx->daycare;
+    TamaPet* shown = &daycare->pets[daycare->shown];
+    uint32_t now = furi_get_tick();
+    bool parked = false;
 
-        /* First 640 half bytes correspond to the RAM */
-        for(uint32_t i = 0; i < MEM_RAM_SIZE; i++) {
-            buf[0] = GET_RAM_MEMORY(state->memory, i + MEM_RAM_ADDR) & 0xF;
-            offset += storage_file_write(file, &buf, 1);
+    shown->live = true;
+    daycare->live = 1;
+
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    File* file = storage_file_alloc(storage);
+    for(uint8_t i = 1; i < TAMA_DAYCARE_PETS; i++) {
+        FuriString* path = tama_p1_pet_path(i);
+        if(path == NULL) continue;
+        if(!storage_file_open(file, furi_string_get_cstr(path), FSAM_READ, FSOM_OPEN_EXISTING)) {
+            storage_file_close(file);
+            continue;
         }
+        size_t size = storage_file_read(file, g_ctx->scratch, TAMA_STATE_SIZE);
+        storage_file_close(file);
 
-        /* I/Os are from 0xF00 to 0xF7F */
-        for(uint32_t i = 0; i < MEM_IO_SIZE; i++) {
-            buf[0] = GET_IO_MEMORY(state->memory, i + MEM_IO_ADDR) & 0xF;
-            offset += storage_file_write(file, &buf, 1);
+        if(!tama_p1_daycare_room(shown) || !tama_p1_daycare_room(&daycare->pets[i])) {
+            FURI_LOG_E(TAG, "No room for pet \"%s\"", furi_string_get_cstr(path));
+            continue;
         }
+        if(!parked) {
+            tama_p1_hal_background(true);
+            tama_p1_daycare_park(shown);
+            parked = true;
+        }
+        if(!tama_p1_daycare_adopt(i, g_ctx->scratch, size, now))
+            FURI_LOG_E(TAG, "Invalid pet state \"%s\"", furi_string_get_cstr(path));
     }
-    storage_file_close(file);
     storage_file_free(file);
     furi_record_close(RECORD_STORAGE);
 
-    FURI_LOG_D(TAG, "Finished Writing %lu", offset);
-    furi_mutex_release(g_state_mutex);
+    if(parked) {
+        tama_p1_daycare_unpark(shown);
+        tama_p1_hal_background(false);
+    }
+    FURI_LOG_I(TAG, "Daycare: %u pets", daycare->live);
+}
+
+bool tama_p1_daycare_show(uint8_t index) {
+    TamaDaycare* daycare = &g_ctx->daycare;
+
+    if(index == daycare->shown) return true;
+    // A movie belongs to the pet it was recorded with
+    if(index >= TAMA_DAYCARE_PETS || g_ctx->rom == NULL ||
+       g_ctx->movie.mode != TamaMovieModeOff)
+        return false;
+
+    TamaPet* pet = &daycare->pets[index];
+    uint32_t now = furi_get_tick();
+
+    if(!pet->live &&
+       (daycare->reset == NULL || !tama_p1_daycare_room(&daycare->pets[daycare->shown]) ||
+        !tama_p1_daycare_room(pet))) {
+        FURI_LOG_W(TAG, "No room for pet %u until the next start", index + 1);
+        return false;
+    }
+
+    TamaPet* last = &daycare->pets[daycare->shown];
+    tama_p1_hal_background(true);
+    tama_p1_daycare_leave(last, now);
+    if(pet->live) {
+        // Owes a visit at most, so this is short enough to run in one go
+        uint32_t steps = UINT32_MAX;
+        tama_p1_daycare_unpark(pet);
+        tama_p1_daycare_catch_up(pet, now, &steps);
+    } else if(tama_p1_daycare_adopt(index, daycare->reset, TAMA_STATE_SIZE, now)) {
+        FURI_LOG_I(TAG, "New pet %u", index + 1);
+    } else {
+        // Back to the last pet, display included, which the adoption cleared
+        FURI_LOG_E(TAG, "Invalid reset state, no pet %u", index + 1);
+        tama_p1_daycare_unpark(last);
+        tama_p1_hal_background(false);
+        tamalib_refresh_hw();
+        return false;
+    }
+    daycare->shown = index;
+    tama_p1_hal_background(false);
+
+    // On time already, don't make it catch up on the lag of the last pet
+    cpu_sync_ref_timestamp();
+    // Its buzzer state went to the background HAL
+    tamalib_refresh_hw();
+    return true;
+}
+
+static void tama_p1_worker_yield() {
+    furi_mutex_release(g_ctx->state_mutex);
+    furi_thread_yield();
+    while(furi_mutex_acquire(g_ctx->state_mutex, FuriWaitForever) != FuriStatusOk)
+        furi_delay_tick(1);
+}
+
+// Returns false once the worker is asked to exit
+static bool tama_p1_worker_events(uint32_t* burst_len) {
+    // Unthrottled, the core never reaches sleep_until to hand the state over
+    if((g_ctx->worker_events & TamaWorkerEventBurst) && ++*burst_len >= TAMA_SCHED_BURST_MAX) {
+        *burst_len = 0;
+        tama_p1_worker_yield();
+    }
+
+    uint8_t events = g_ctx->worker_events;
+    if(events & TamaWorkerEventExit) return false;
+    // Visits are unthrottled as well, and hand over the state after every burst
+    if((events & TamaWorkerEventDaycare) &&
+       (g_ctx->daycare.visit_left != 0 ||
+        (int32_t)(furi_get_tick() - g_ctx->daycare.next_visit) >= 0) &&
+       !tama_p1_daycare_visit())
+        tama_p1_worker_yield();
+    if(events & TamaWorkerEventInput) tama_p1_input_apply();
+    if(events & TamaWorkerEventReplay) tama_p1_movie_replay_step();
+    return true;
 }
 
 static int32_t tama_p1_worker(void* context) {
-    bool running = true;
-    FuriMutex* mutex = context;
+    uint32_t burst_len = 0;
+    TamaApp* ctx = context;
+    FuriMutex* mutex = ctx->state_mutex;
     while(furi_mutex_acquire(mutex, FuriWaitForever) != FuriStatusOk)
         furi_delay_tick(1);
 
     cpu_sync_ref_timestamp();
     LL_TIM_EnableCounter(TIM2);
 
+    // New daycare pets start from here
+    if(g_ctx->daycare.reset != NULL) tama_state_save(g_ctx->daycare.reset);
     tama_p1_load_state();
+    tama_p1_daycare_start();
 
-    while(running) {
-        if(furi_thread_flags_get()) {
-            running = false;
-        } else {
-            // FURI_LOG_D(TAG, "Stepping");
-            // for (int i = 0; i < 100; ++i)
-            tamalib_step();
-        }
+    // Everything due between two steps is flagged in worker_events, so the common
+    // step costs one compare here
+    while(true) {
+        if(ctx->worker_events && !tama_p1_worker_events(&burst_len)) break;
+        tamalib_step();
     }
 
-    if(furi_hal_speaker_is_mine()) {
-        furi_hal_speaker_stop();
-        furi_hal_speaker_release();
-    }
+#ifdef TAMA_PROFILE_DIAG
+    TamaDiag* diag = &g_ctx->diag;
+    FURI_LOG_I(
+        TAG,
+        "HAL calls: %lu pixels, %lu icons, %lu frequency, %lu play, %lu sleeps, %lu logs",
+        diag->lcd_matrix,
+        diag->lcd_icon,
+        diag->set_frequency,
+        diag->play_frequency,
+        diag->sleeps,
+        diag->logs);
+#endif
+
+#ifndef TAMA_PROFILE_RELEASE
+    TamaSched* sched = &g_ctx->sched;
+    FURI_LOG_I(
+        TAG,
+        "Scheduler: drift %ld max %ld, %lu late steps, %lu bursts, %lu sleeps",
+        sched->drift,
+        sched->drift_max,
+        sched->late_steps,
+        sched->bursts,
+        sched->sleeps);
+#endif
+
+    TamaDaycare* daycare = &g_ctx->daycare;
+    FURI_LOG_I(
+        TAG,
+        "Daycare: %u pets, %lu visits, %lu late",
+        daycare->live,
+        daycare->visits,
+        daycare->late);
+
+    TamaLowPower* low_power = &g_ctx->low_power;
+    uint32_t low_power_ticks = low_power->ticks;
+    if(low_power->reasons) low_power_ticks += furi_get_tick() - low_power->since;
+    FURI_LOG_I(
+        TAG,
+        "Low power: %lu periods, %lu ms, duty cycle %lu%%",
+        low_power->entries,
+        low_power_ticks * 1000 / furi_kernel_get_tick_frequency(),
+        low_power_ticks ? (low_power_ticks - low_power->slept) * 100 / low_power_ticks : 100);
 
     LL_TIM_DisableCounter(TIM2);
     furi_hal_bus_disable(FuriHalBusTIM2);
@@ -308,32 +730,56 @@ static int32_t tama_p1_worker(void* context) {
     return 0;
 }
 
-static void tama_p1_init(TamaApp* const ctx) {
+// ctx comes from arena, which it takes over; rom_size is 0 without a ROM and
+// saves the number of pet save files arena was sized for
+static void tama_p1_init(
+    TamaApp* const ctx,
+    const TamaArena* arena,
+    size_t rom_size,
+    uint8_t saves) {
     g_ctx = ctx;
     memset(ctx, 0, sizeof(TamaApp));
-    tama_p1_hal_init(&ctx->hal);
+    ctx->arena = *arena;
+    ctx->state_mutex = furi_mutex_alloc(FuriMutexTypeRecursive);
+    ctx->draw_mutex = furi_mutex_alloc(FuriMutexTypeRecursive);
+    ctx->cpu_speed = TamaSpeed1x;
+    ctx->clock.slowdown = 1;
+    ctx->lcd_dirty = true;
+    ctx->scratch = tama_arena_alloc(&ctx->arena, TAMA_MOVIE_HEADER_SIZE);
+    // Before the worker starts, which fills it in
+    if(1 + saves < TAMA_DAYCARE_PETS && TAMA_DAYCARE_ADOPT_MAX > 0)
+        ctx->daycare.reset = tama_arena_alloc(&ctx->arena, TAMA_STATE_SIZE);
+    tama_p1_hal_init(&ctx->hal, &ctx->hal_background);
 
     // Load ROM
     Storage* storage = furi_record_open(RECORD_STORAGE);
-    FileInfo fi;
-    if(g_rom_path != NULL &&
-       storage_common_stat(storage, furi_string_get_cstr(g_rom_path), &fi) == FSE_OK) {
+    if(rom_size > 0) {
         File* rom_file = storage_file_alloc(storage);
         if(storage_file_open(
                rom_file, furi_string_get_cstr(g_rom_path), FSAM_READ, FSOM_OPEN_EXISTING)) {
-            ctx->rom = malloc((size_t)fi.size);
+            ctx->rom = tama_arena_alloc(&ctx->arena, rom_size);
+        }
+        if(ctx->rom != NULL) {
             uint8_t* buf_ptr = ctx->rom;
             size_t read = 0;
-            while(read < fi.size) {
-                size_t to_read = fi.size - read;
+            while(read < rom_size) {
+                size_t to_read = rom_size - read;
                 if(to_read > UINT16_MAX) to_read = UINT16_MAX;
                 uint16_t now_read = storage_file_read(rom_file, buf_ptr, (uint16_t)to_read);
+                if(now_read == 0) break;
                 read += now_read;
                 buf_ptr += now_read;
             }
 
+            // Shrunk since it was sized up, don't run a truncated ROM
+            if(read < rom_size) {
+                FURI_LOG_E(TAG, "Short ROM read, %u of %u bytes", read, rom_size);
+                ctx->rom = NULL;
+            }
+        }
+        if(ctx->rom != NULL) {
             // Reorder endianess of ROM
-            for(size_t i = 0; i < fi.size; i += 2) {
+            for(size_t i = 0; i < rom_size; i += 2) {
                 uint8_t b = ctx->rom[i];
                 ctx->rom[i] = ctx->rom[i + 1];
                 ctx->rom[i + 1] = b & 0xF;
@@ -348,7 +794,7 @@ static void tama_p1_init(TamaApp* const ctx) {
     if(ctx->rom != NULL) {
         // Init TIM2
         furi_hal_bus_enable(FuriHalBusTIM2);
-        // 64KHz
+        // 64KHz, keep in sync with TAMA_TIMER_FREQ
         LL_TIM_InitTypeDef tim_init = {
             .Prescaler = 999,
             .CounterMode = LL_TIM_COUNTERMODE_UP,
@@ -359,10 +805,12 @@ static void tama_p1_init(TamaApp* const ctx) {
         LL_TIM_DisableCounter(TIM2);
         LL_TIM_SetCounter(TIM2, 0);
 
+        tama_p1_hal_audio_start();
+
         // Init TamaLIB
         tamalib_register_hal(&ctx->hal);
-        tamalib_init((u12_t*)ctx->rom, NULL, 64000);
-        tamalib_set_speed(1);
+        tamalib_init((u12_t*)ctx->rom, NULL, TAMA_TIMER_FREQ);
+        tama_p1_hal_set_speed(TAMA_SPEED_DEFAULT);
 
         // TODO: implement fast forwarding
         ctx->fast_forward_done = true;
@@ -372,7 +820,7 @@ static void tama_p1_init(TamaApp* const ctx) {
         furi_thread_set_name(ctx->thread, "TamaLIB");
         furi_thread_set_stack_size(ctx->thread, 1024);
         furi_thread_set_callback(ctx->thread, tama_p1_worker);
-        furi_thread_set_context(ctx->thread, g_state_mutex);
+        furi_thread_set_context(ctx->thread, ctx);
         furi_thread_start(ctx->thread);
     }
 }
@@ -381,8 +829,10 @@ static void tama_p1_deinit(TamaApp* const ctx) {
     if(ctx->rom != NULL) {
         tamalib_release();
         furi_thread_free(ctx->thread);
-        free(ctx->rom);
     }
+
+    furi_mutex_free(ctx->state_mutex);
+    furi_mutex_free(ctx->draw_mutex);
 }
 
 static void tama_p1_game_callback(TamaGameEventType event_type, void* context) {
@@ -398,6 +848,7 @@ static void tama_p1_game_callback(TamaGameEventType event_type, void* context) {
         break;
 
     case TamaGameEventTypeClose:
+        tama_menu_refresh(g_menu);
         view_dispatcher_switch_to_view(view_dispatcher, TamaViewMenu);
         break;
     }
@@ -417,6 +868,26 @@ static void tama_p1_menu_callback(TamaMenuEventType event_type, void* context) {
         tama_p1_load_state();
         break;
 
+    case TamaMenuEventTypeRecordStart:
+        tama_p1_movie_record_start();
+        break;
+
+    case TamaMenuEventTypeRecordStop:
+        tama_p1_movie_record_stop();
+        break;
+
+    case TamaMenuEventTypeReplay:
+        tama_p1_movie_replay_start();
+        break;
+
+    case TamaMenuEventTypeCaptureStart:
+        if(g_ctx->rom != NULL) tama_p1_capture_start();
+        break;
+
+    case TamaMenuEventTypeCaptureStop:
+        tama_p1_capture_stop();
+        break;
+
     case TamaMenuEventTypeReset:
         g_mode = TamaModeReset;
         view_dispatcher_stop(view_dispatcher);
@@ -438,11 +909,58 @@ static void tama_p1_menu_callback(TamaMenuEventType event_type, void* context) {
     }
 }
 
+static size_t tama_p1_rom_size() {
+    size_t size = 0;
+    FileInfo fi;
+
+    if(g_rom_path == NULL) return 0;
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    if(storage_common_stat(storage, furi_string_get_cstr(g_rom_path), &fi) == FSE_OK)
+        size = (size_t)fi.size;
+    furi_record_close(RECORD_STORAGE);
+    return size;
+}
+
+// Pets other than pet 0 with a save file
+static uint8_t tama_p1_pet_saves() {
+    uint8_t saves = 0;
+    FileInfo fi;
+
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    for(uint8_t i = 1; i < TAMA_DAYCARE_PETS; i++) {
+        if(g_pet_paths[i] != NULL &&
+           storage_common_stat(storage, furi_string_get_cstr(g_pet_paths[i]), &fi) == FSE_OK)
+            saves++;
+    }
+    furi_record_close(RECORD_STORAGE);
+    return saves;
+}
+
+// Only RAM, registers and the display per pet, the ROM is shared. Pet 0 needs
+// a snapshot too once there is a second pet, new pets the reset state.
+static size_t tama_p1_daycare_budget(uint8_t saves) {
+    uint8_t pets = 1 + saves + TAMA_DAYCARE_ADOPT_MAX;
+    if(pets > TAMA_DAYCARE_PETS) pets = TAMA_DAYCARE_PETS;
+    if(pets == 1) return 0;
+
+    size_t size = pets * (TAMA_DAYCARE_SNAPSHOT_SIZE + TAMA_ARENA_ALIGN);
+    if(pets > 1 + saves) size += TAMA_STATE_SIZE + TAMA_ARENA_ALIGN;
+    return size;
+}
+
 static void tama_p1_start() {
-    TamaApp* ctx = malloc(sizeof(TamaApp));
-    g_state_mutex = furi_mutex_alloc(FuriMutexTypeRecursive);
-    g_draw_mutex = furi_mutex_alloc(FuriMutexTypeRecursive);
-    tama_p1_init(ctx);
+    // Everything the emulator allocates for this session comes from one block,
+    // sized once from the ROM and the pets so init reads exactly what was
+    // budgeted for
+    size_t rom_size = tama_p1_rom_size();
+    uint8_t saves = tama_p1_pet_saves();
+    TamaArena arena;
+    tama_arena_init(
+        &arena,
+        sizeof(TamaApp) + TAMA_MOVIE_HEADER_SIZE + rom_size + 3 * TAMA_ARENA_ALIGN +
+            tama_p1_daycare_budget(saves) + TAMA_ARENA_HAL_SIZE);
+    TamaApp* ctx = tama_arena_alloc(&arena, sizeof(TamaApp));
+    tama_p1_init(ctx, &arena, rom_size, saves);
 
     Gui* gui = furi_record_open(RECORD_GUI);
 
@@ -456,6 +974,7 @@ static void tama_p1_start() {
     view_dispatcher_add_view(view_dispatcher, TamaViewGame, tama_game_get_view(tama_game));
 
     TamaMenu* tama_menu = tama_menu_alloc();
+    g_menu = tama_menu;
     tama_menu_set_callback(tama_menu, tama_p1_menu_callback, view_dispatcher);
     view_dispatcher_add_view(view_dispatcher, TamaViewMenu, tama_menu_get_view(tama_menu));
 
@@ -466,24 +985,44 @@ static void tama_p1_start() {
     view_dispatcher_run(view_dispatcher);
 
     if(ctx->rom != NULL) {
-        furi_thread_flags_set(furi_thread_get_id(ctx->thread), 1);
+        furi_mutex_acquire(ctx->state_mutex, FuriWaitForever);
+        ctx->worker_events |= TamaWorkerEventExit;
+        furi_mutex_release(ctx->state_mutex);
+        // Still wakes a worker sleeping in yield
+        furi_thread_flags_set(furi_thread_get_id(ctx->thread), TAMA_WORKER_FLAG_EXIT);
         furi_thread_join(ctx->thread);
+        tama_p1_hal_audio_stop();
+    }
+
+    if(ctx->movie.mode == TamaMovieModeRecord) {
+        tama_p1_movie_record_stop();
+    } else if(ctx->movie.mode == TamaMovieModeReplay) {
+        tama_p1_movie_close();
     }
 
     furi_timer_free(ctx->timer);
     ctx->timer = NULL;
+    tama_p1_capture_stop();
 
     view_dispatcher_remove_view(view_dispatcher, TamaViewGame);
     view_dispatcher_remove_view(view_dispatcher, TamaViewMenu);
     tama_game_free(tama_game);
     tama_menu_free(tama_menu);
+    g_menu = NULL;
     view_dispatcher_free(view_dispatcher);
     furi_record_close(RECORD_GUI);
 
-    furi_mutex_free(g_state_mutex);
-    furi_mutex_free(g_draw_mutex);
     tama_p1_deinit(ctx);
-    free(ctx);
+    // ctx lives in the arena, take it out before the block goes
+    arena = ctx->arena;
+    FURI_LOG_I(
+        TAG,
+        "Arena: %u of %u bytes peak, %lu allocations, %lu failed",
+        arena.peak,
+        arena.size,
+        arena.allocs,
+        arena.failed);
+    tama_arena_release(&arena);
 }
 
 static FuriString* tama_p1_browse_path() {
@@ -509,6 +1048,20 @@ static FuriString* tama_p1_browse_path() {
     return path;
 }
 
+static FuriString* tama_p1_sibling_path(const char* ext) {
+    FuriString* path;
+    if(g_rom_path == NULL) return NULL;
+
+    path = furi_string_alloc();
+    furi_string_set(path, g_rom_path);
+
+    size_t pos = furi_string_search_rchar(path, '.');
+    if(pos != FURI_STRING_FAILURE) furi_string_left(path, pos);
+
+    furi_string_cat_str(path, ext);
+    return path;
+}
+
 int32_t tama_p1_app(void* p) {
     UNUSED(p);
 
@@ -530,20 +1083,25 @@ int32_t tama_p1_app(void* p) {
             continue;
         }
 
-        if(g_rom_path != NULL) {
-            g_sav_path = furi_string_alloc();
-            furi_string_set(g_sav_path, g_rom_path);
-
-            size_t pos = furi_string_search_rchar(g_sav_path, '.');
-            if(pos != FURI_STRING_FAILURE) furi_string_left(g_sav_path, pos);
-
-            furi_string_cat_str(g_sav_path, ".sav");
+        g_sav_path = tama_p1_sibling_path(".sav");
+        g_mov_path = tama_p1_sibling_path(".mov");
+        g_cap_path = tama_p1_sibling_path(".tcap");
+        for(uint8_t i = 1; i < TAMA_DAYCARE_PETS; i++) {
+            char ext[8];
+            snprintf(ext, sizeof(ext), ".%u.sav", i);
+            g_pet_paths[i] = tama_p1_sibling_path(ext);
         }
 
         tama_p1_start();
 
         if(g_rom_path != NULL) furi_string_free(g_rom_path);
         if(g_sav_path != NULL) furi_string_free(g_sav_path);
+        if(g_mov_path != NULL) furi_string_free(g_mov_path);
+        if(g_cap_path != NULL) furi_string_free(g_cap_path);
+        for(uint8_t i = 1; i < TAMA_DAYCARE_PETS; i++) {
+            if(g_pet_paths[i] != NULL) furi_string_free(g_pet_paths[i]);
+            g_pet_paths[i] = NULL;
+        }
     }
 
     return 0;
@@ -0,0 +1,271 @@
+#include <string.h>
+#include <tamalib.h>
+#include "tama_state.h"
+
+// One serialized field: where it lives, how wide it is in memory and in the
+// file (little endian), and which bits are valid. Only tama_state_diff needs
+// the name, which keeps it out of the app.
+typedef struct {
+#ifdef TAMA_STATE_DIFF
+    const char* name;
+#endif
+    uint16_t offset;
+    uint8_t size;
+    uint8_t bytes;
+    uint32_t mask;
+} TamaStateField;
+
+#ifdef TAMA_STATE_DIFF
+#define TAMA_STATE_NAME(name) #name,
+#else
+#define TAMA_STATE_NAME(name)
+#endif
+
+// state_t only holds pointers, so the offset is that of the pointer member
+#define TAMA_STATE_REG(name, bytes, mask) \
+    {TAMA_STATE_NAME(name) offsetof(state_t, name), sizeof(*((state_t*)NULL)->name), bytes, mask}
+#define TAMA_STATE_INT(name, mask)                     \
+    {TAMA_STATE_NAME(name) offsetof(interrupt_t, name), \
+     sizeof(((interrupt_t*)NULL)->name), 1, mask}
+#define TAMA_STATE_COUNT(table) (sizeof(table) / sizeof(table[0]))
+
+static const TamaStateField tama_state_regs[] = {
+    TAMA_STATE_REG(pc, 2, 0x1FFF),
+    TAMA_STATE_REG(x, 2, 0xFFF),
+    TAMA_STATE_REG(y, 2, 0xFFF),
+    TAMA_STATE_REG(a, 1, 0xF),
+    TAMA_STATE_REG(b, 1, 0xF),
+    TAMA_STATE_REG(np, 1, 0x1F),
+    TAMA_STATE_REG(sp, 1, 0xFF),
+    TAMA_STATE_REG(flags, 1, 0xF),
+    TAMA_STATE_REG(tick_counter, 4, 0xFFFFFFFF),
+    TAMA_STATE_REG(clk_timer_timestamp, 4, 0xFFFFFFFF),
+    TAMA_STATE_REG(prog_timer_timestamp, 4, 0xFFFFFFFF),
+    TAMA_STATE_REG(prog_timer_enabled, 1, 0x1),
+    TAMA_STATE_REG(prog_timer_data, 1, 0xFF),
+    TAMA_STATE_REG(prog_timer_rld, 1, 0xFF),
+    TAMA_STATE_REG(call_depth, 4, 0xFFFFFFFF),
+};
+
+// Repeated for each of the INT_SLOT_NUM interrupt slots
+static const TamaStateField tama_state_ints[] = {
+    TAMA_STATE_INT(factor_flag_reg, 0xF),
+    TAMA_STATE_INT(mask_reg, 0xF),
+    TAMA_STATE_INT(triggered, 0x1),
+};
+
+static uint32_t tama_state_read(const void* ptr, uint8_t size) {
+    switch(size) {
+    case 1:
+        return *(const uint8_t*)ptr;
+    case 2:
+        return *(const uint16_t*)ptr;
+    default:
+        return *(const uint32_t*)ptr;
+    }
+}
+
+static void tama_state_write(void* ptr, uint8_t size, uint32_t val) {
+    switch(size) {
+    case 1:
+        *(uint8_t*)ptr = val;
+        break;
+    case 2:
+        *(uint16_t*)ptr = val;
+        break;
+    default:
+        *(uint32_t*)ptr = val;
+        break;
+    }
+}
+
+static uint32_t tama_state_get(const uint8_t* buf, uint8_t bytes) {
+    uint32_t val = 0;
+    for(uint8_t i = 0; i < bytes; i++)
+        val |= (uint32_t)buf[i] << (i * 8);
+    return val;
+}
+
+static void tama_state_put(uint8_t* buf, uint8_t bytes, uint32_t val) {
+    for(uint8_t i = 0; i < bytes; i++)
+        buf[i] = (val >> (i * 8)) & 0xFF;
+}
+
+static void* tama_state_reg_ptr(state_t* state, const TamaStateField* field) {
+    return *(void**)((uint8_t*)state + field->offset);
+}
+
+static void* tama_state_int_ptr(state_t* state, uint32_t slot, const TamaStateField* field) {
+    return (uint8_t*)&state->interrupts[slot] + field->offset;
+}
+
+static bool tama_state_check(const uint8_t** ptr, const TamaStateField* field) {
+    uint32_t val = tama_state_get(*ptr, field->bytes);
+    *ptr += field->bytes;
+    return (val & ~field->mask) == 0;
+}
+
+size_t tama_state_save(uint8_t* buf) {
+    state_t* state = tamalib_get_state();
+    uint8_t* ptr = buf;
+
+    memcpy(ptr, STATE_FILE_MAGIC, 4);
+    ptr += 4;
+    *ptr++ = STATE_FILE_VERSION & 0xFF;
+
+    for(size_t i = 0; i < TAMA_STATE_COUNT(tama_state_regs); i++) {
+        const TamaStateField* field = &tama_state_regs[i];
+        uint32_t val = tama_state_read(tama_state_reg_ptr(state, field), field->size);
+        tama_state_put(ptr, field->bytes, val & field->mask);
+        ptr += field->bytes;
+    }
+
+    for(uint32_t slot = 0; slot < INT_SLOT_NUM; slot++) {
+        for(size_t i = 0; i < TAMA_STATE_COUNT(tama_state_ints); i++) {
+            const TamaStateField* field = &tama_state_ints[i];
+            uint32_t val = tama_state_read(tama_state_int_ptr(state, slot, field), field->size);
+            tama_state_put(ptr, field->bytes, val & field->mask);
+            ptr += field->bytes;
+        }
+    }
+
+    /* First 640 half bytes correspond to the RAM */
+    for(uint32_t i = 0; i < MEM_RAM_SIZE; i++) {
+        *ptr++ = GET_RAM_MEMORY(state->memory, i + MEM_RAM_ADDR) & 0xF;
+    }
+
+    /* I/Os are from 0xF00 to 0xF7F */
+    for(uint32_t i = 0; i < MEM_IO_SIZE; i++) {
+        *ptr++ = GET_IO_MEMORY(state->memory, i + MEM_IO_ADDR) & 0xF;
+    }
+
+    return ptr - buf;
+}
+
+bool tama_state_validate(const uint8_t* buf, size_t size) {
+    const uint8_t* ptr = buf;
+
+    if(size < TAMA_STATE_SIZE) return false;
+    if(memcmp(ptr, STATE_FILE_MAGIC, 4) != 0) return false;
+    ptr += 4;
+    if(*ptr++ != STATE_FILE_VERSION) return false;
+
+    for(size_t i = 0; i < TAMA_STATE_COUNT(tama_state_regs); i++) {
+        if(!tama_state_check(&ptr, &tama_state_regs[i])) return false;
+    }
+
+    for(uint32_t slot = 0; slot < INT_SLOT_NUM; slot++) {
+        for(size_t i = 0; i < TAMA_STATE_COUNT(tama_state_ints); i++) {
+            if(!tama_state_check(&ptr, &tama_state_ints[i])) return false;
+        }
+    }
+
+    // RAM and I/O are stored one nibble per byte
+    for(uint32_t i = 0; i < MEM_RAM_SIZE + MEM_IO_SIZE; i++) {
+        if(*ptr++ > 0xF) return false;
+    }
+
+    return true;
+}
+
+bool tama_state_load(const uint8_t* buf, size_t size) {
+    state_t* state = tamalib_get_state();
+
+    if(!tama_state_validate(buf, size)) return false;
+    const uint8_t* ptr = buf + 5;
+
+    for(size_t i = 0; i < TAMA_STATE_COUNT(tama_state_regs); i++) {
+        const TamaStateField* field = &tama_state_regs[i];
+        uint32_t val = tama_state_get(ptr, field->bytes);
+        tama_state_write(tama_state_reg_ptr(state, field), field->size, val);
+        ptr += field->bytes;
+    }
+
+    for(uint32_t slot = 0; slot < INT_SLOT_NUM; slot++) {
+        for(size_t i = 0; i < TAMA_STATE_COUNT(tama_state_ints); i++) {
+            const TamaStateField* field = &tama_state_ints[i];
+            uint32_t val = tama_state_get(ptr, field->bytes);
+            tama_state_write(tama_state_int_ptr(state, slot, field), field->size, val);
+            ptr += field->bytes;
+        }
+    }
+
+    /* First 640 half bytes correspond to the RAM */
+    for(uint32_t i = 0; i < MEM_RAM_SIZE; i++) {
+        SET_RAM_MEMORY(state->memory, i + MEM_RAM_ADDR, *ptr++);
+    }
+
+    /* I/Os are from 0xF00 to 0xF7F */
+    for(uint32_t i = 0; i < MEM_IO_SIZE; i++) {
+        SET_IO_MEMORY(state->memory, i + MEM_IO_ADDR, *ptr++);
+    }
+
+    tamalib_refresh_hw();
+    return true;
+}
+
+#ifdef TAMA_STATE_DIFF
+size_t tama_state_diff(
+    const uint8_t* a,
+    const uint8_t* b,
+    TamaStateDiffCallback callback,
+    void* context) {
+    size_t diffs = 0;
+    size_t pos = 5;
+
+    for(size_t i = 0; i < TAMA_STATE_COUNT(tama_state_regs); i++) {
+        const TamaStateField* field = &tama_state_regs[i];
+        uint32_t val_a = tama_state_get(a + pos, field->bytes);
+        uint32_t val_b = tama_state_get(b + pos, field->bytes);
+        if(val_a != val_b) {
+            callback(field->name, -1, val_a, val_b, context);
+            diffs++;
+        }
+        pos += field->bytes;
+    }
+
+    for(int32_t slot = 0; slot < INT_SLOT_NUM; slot++) {
+        for(size_t i = 0; i < TAMA_STATE_COUNT(tama_state_ints); i++) {
+            if(a[pos] != b[pos]) {
+                callback(tama_state_ints[i].name, slot, a[pos], b[pos], context);
+                diffs++;
+            }
+            pos++;
+        }
+    }
+
+    for(int32_t i = 0; i < MEM_RAM_SIZE + MEM_IO_SIZE; i++, pos++) {
+        if(a[pos] == b[pos]) continue;
+        if(i < MEM_RAM_SIZE) {
+            callback("ram", MEM_RAM_ADDR + i, a[pos], b[pos], context);
+        } else {
+            callback("io", MEM_IO_ADDR + i - MEM_RAM_SIZE, a[pos], b[pos], context);
+        }
+        diffs++;
+    }
+
+    return diffs;
+}
+#endif
+
+void tama_state_save_display(uint8_t* buf) {
+    const MEM_BUFFER_TYPE* memory = tamalib_get_state()->memory;
+
+    for(uint32_t i = 0; i < MEM_DISPLAY1_SIZE; i++) {
+        *buf++ = GET_DISP1_MEMORY(memory, i + MEM_DISPLAY1_ADDR) & 0xF;
+    }
+    for(uint32_t i = 0; i < MEM_DISPLAY2_SIZE; i++) {
+        *buf++ = GET_DISP2_MEMORY(memory, i + MEM_DISPLAY2_ADDR) & 0xF;
+    }
+}
+
+void tama_state_load_display(const uint8_t* buf) {
+    MEM_BUFFER_TYPE* memory = tamalib_get_state()->memory;
+
+    for(uint32_t i = 0; i < MEM_DISPLAY1_SIZE; i++) {
+        SET_DISP1_MEMORY(memory, i + MEM_DISPLAY1_ADDR, *buf++);
+    }
+    for(uint32_t i = 0; i < MEM_DISPLAY2_SIZE; i++) {
+        SET_DISP2_MEMORY(memory, i + MEM_DISPLAY2_ADDR, *buf++);
+    }
+}
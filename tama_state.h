@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tamalib.h>
+
+#define STATE_FILE_MAGIC   "TLST"
+#define STATE_FILE_VERSION 2
+
+// Magic, version, registers and timers, then the three interrupt fields per
+// slot, then one byte per RAM and I/O nibble
+#define TAMA_STATE_REGS_SIZE 35
+#define TAMA_STATE_SIZE      (TAMA_STATE_REGS_SIZE + INT_SLOT_NUM * 3 + MEM_RAM_SIZE + MEM_IO_SIZE)
+// Both display memories, one byte per nibble
+#define TAMA_STATE_DISPLAY_SIZE (MEM_DISPLAY1_SIZE + MEM_DISPLAY2_SIZE)
+
+/*
+ * Both directions are driven by one field table, so the same buffer format
+ * serves save files, movie headers and in-memory snapshots.
+ *
+ * Serializes the TamaLIB CPU state into buf, which must hold TAMA_STATE_SIZE
+ * bytes, in the save file format. Returns the number of bytes written.
+ */
+size_t tama_state_save(uint8_t* buf);
+
+/*
+ * Checks a buffer in the save file format without touching the CPU state.
+ * Returns false if it is too short, has the wrong magic or version, or holds
+ * a value with bits outside its register width.
+ */
+bool tama_state_validate(const uint8_t* buf, size_t size);
+
+/*
+ * Restores the TamaLIB CPU state from a buffer in the save file format and
+ * refreshes the hardware. Returns false, leaving the state untouched, if the
+ * buffer does not pass tama_state_validate.
+ */
+bool tama_state_load(const uint8_t* buf, size_t size);
+
+#ifdef TAMA_STATE_DIFF
+typedef void (*TamaStateDiffCallback)(
+    const char* name,
+    int32_t index,
+    uint32_t a,
+    uint32_t b,
+    void* context);
+
+/*
+ * Compares two valid buffers in the save file format field by field, calling
+ * callback for each one that differs with the register name, or the
+ * interrupt field name and slot, or "ram"/"io" and the nibble address; index
+ * is -1 for registers. Returns the number of differences. Host tools only,
+ * built with TAMA_STATE_DIFF.
+ */
+size_t tama_state_diff(
+    const uint8_t* a,
+    const uint8_t* b,
+    TamaStateDiffCallback callback,
+    void* context);
+#endif
+
+/*
+ * Save files leave the display memory to the ROM to redraw. Snapshots that
+ * swap one CPU state for another in place keep it alongside, in
+ * TAMA_STATE_DISPLAY_SIZE bytes. Loading does not refresh the LCD.
+ */
+void tama_state_save_display(uint8_t* buf);
+void tama_state_load_display(const uint8_t* buf);
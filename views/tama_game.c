@@ -1,14 +1,9 @@
 #include <gui/view.h>
+#include <toolbox/compress.h>
 #include "../tama.h"
 #include "tama_game.h"
 #include "compiled/assets_icons.h"
 
-typedef struct TamaGame {
-    View* view;
-    TamaGameCallback callback;
-    void* context;
-} TamaGame;
-
 static const Icon* icons_list[] = {
     &I_icon_0,
     &I_icon_1,
@@ -20,10 +15,78 @@ static const Icon* icons_list[] = {
     &I_icon_7,
 };
 
-static void tama_draw_callback(Canvas* canvas, void* context) {
-    UNUSED(context);
+#define TAMA_LCD_ICON_NUM   COUNT_OF(icons_list)
+#define TAMA_LCD_ICON_BYTES (((TAMA_LCD_ICON_SIZE + 7) / 8) * TAMA_LCD_ICON_SIZE)
+
+typedef struct {
+    uint8_t x;
+    uint8_t y;
+    const uint8_t* bitmap;
+} TamaIconSlot;
+
+typedef struct {
+    // Some assets are heatshrink compressed, so they are decoded once into XBM
+    // here instead of on every canvas_draw_icon call.
+    uint8_t bitmaps[TAMA_LCD_ICON_NUM][TAMA_LCD_ICON_BYTES];
+    // Visible icons, only rebuilt when the LCD icon bits change
+    TamaIconSlot slots[TAMA_LCD_ICON_NUM];
+    uint8_t slot_count;
+    uint8_t slot_icons;
+} TamaIconCache;
+
+typedef struct TamaGame {
+    View* view;
+    TamaGameCallback callback;
+    void* context;
+    TamaIconCache icon_cache;
+} TamaGame;
+
+static void tama_icon_cache_decode(TamaIconCache* cache) {
+    CompressIcon* compress_icon = compress_icon_alloc(TAMA_LCD_ICON_BYTES);
+
+    for(size_t i = 0; i < TAMA_LCD_ICON_NUM; ++i) {
+        uint8_t* bitmap;
+        compress_icon_decode(compress_icon, icon_get_data(icons_list[i]), &bitmap);
+        memcpy(cache->bitmaps[i], bitmap, TAMA_LCD_ICON_BYTES);
+    }
 
-    if(furi_mutex_acquire(g_draw_mutex, 25) != FuriStatusOk) return;
+    compress_icon_free(compress_icon);
+
+    cache->slot_count = 0;
+    cache->slot_icons = 0;
+}
+
+static void tama_icon_cache_update(TamaIconCache* cache, uint8_t lcd_icons) {
+    if(lcd_icons == cache->slot_icons) return;
+    cache->slot_icons = lcd_icons;
+    cache->slot_count = 0;
+
+    // Icons 0-6 along the bottom, 7 in the top right corner
+    uint8_t x_ic = 0;
+    for(uint8_t i = 0; i < 7; ++i) {
+        if(lcd_icons & (1 << i)) {
+            cache->slots[cache->slot_count++] = (TamaIconSlot){
+                .x = x_ic,
+                .y = 64 - TAMA_LCD_ICON_SIZE,
+                .bitmap = cache->bitmaps[i],
+            };
+        }
+        x_ic += TAMA_LCD_ICON_SIZE + 4;
+    }
+
+    if(lcd_icons & (1 << 7)) {
+        cache->slots[cache->slot_count++] = (TamaIconSlot){
+            .x = 128 - TAMA_LCD_ICON_SIZE,
+            .y = 0,
+            .bitmap = cache->bitmaps[7],
+        };
+    }
+}
+
+static void tama_draw_callback(Canvas* canvas, void* model) {
+    TamaIconCache* cache = &(*(TamaGame**)model)->icon_cache;
+
+    if(furi_mutex_acquire(g_ctx->draw_mutex, 25) != FuriStatusOk) return;
 
     if(g_ctx->rom == NULL) {
         canvas_set_font(canvas, FontPrimary);
@@ -51,6 +114,8 @@ static void tama_draw_callback(Canvas* canvas, void* context) {
             (lcd_matrix_scaled_width - (4 * TAMA_LCD_ICON_SIZE)) / 3 + TAMA_LCD_ICON_SIZE;
         */
 
+        tama_p1_hal_lcd_sync();
+
         uint16_t y = lcd_matrix_top;
         for(uint8_t row = 0; row < 16; ++row) {
             uint16_t x = lcd_matrix_left;
@@ -66,24 +131,16 @@ static void tama_draw_callback(Canvas* canvas, void* context) {
             y += TAMA_SCREEN_SCALE_FACTOR;
         }
 
-        // Draw Icons on bottom
-        uint8_t lcd_icons = g_ctx->icons;
-        uint16_t x_ic = 0;
-        y = 64 - TAMA_LCD_ICON_SIZE;
-        for(uint8_t i = 0; i < 7; ++i) {
-            if(lcd_icons & 1) {
-                canvas_draw_icon(canvas, x_ic, y, icons_list[i]);
-            }
-            x_ic += TAMA_LCD_ICON_SIZE + 4;
-            lcd_icons >>= 1;
-        }
-
-        if(lcd_icons & 7) {
-            canvas_draw_icon(canvas, 128 - TAMA_LCD_ICON_SIZE, 0, icons_list[7]);
+        // Draw Icons
+        tama_icon_cache_update(cache, g_ctx->icons);
+        for(uint8_t i = 0; i < cache->slot_count; ++i) {
+            const TamaIconSlot* slot = &cache->slots[i];
+            canvas_draw_xbm(
+                canvas, slot->x, slot->y, TAMA_LCD_ICON_SIZE, TAMA_LCD_ICON_SIZE, slot->bitmap);
         }
     }
 
-    furi_mutex_release(g_draw_mutex);
+    furi_mutex_release(g_ctx->draw_mutex);
 }
 
 static bool tama_input_callback(InputEvent* input_event, void* context) {
@@ -91,7 +148,7 @@ static bool tama_input_callback(InputEvent* input_event, void* context) {
 
     TamaGame* tama_game = context;
 
-    if(furi_mutex_acquire(g_state_mutex, FuriWaitForever) != FuriStatusOk) return false;
+    if(furi_mutex_acquire(g_ctx->state_mutex, FuriWaitForever) != FuriStatusOk) return false;
 
     FURI_LOG_D(
         TAG,
@@ -109,11 +166,11 @@ static bool tama_input_callback(InputEvent* input_event, void* context) {
             tama_btn_state = BTN_STATE_RELEASED;
 
         if(input_event->key == InputKeyLeft)
-            tamalib_set_button(BTN_LEFT, tama_btn_state);
+            tama_p1_input_push(BTN_LEFT, tama_btn_state);
         else if(input_event->key == InputKeyOk)
-            tamalib_set_button(BTN_MIDDLE, tama_btn_state);
+            tama_p1_input_push(BTN_MIDDLE, tama_btn_state);
         else if(input_event->key == InputKeyRight)
-            tamalib_set_button(BTN_RIGHT, tama_btn_state);
+            tama_p1_input_push(BTN_RIGHT, tama_btn_state);
     } else if(input_event->key == InputKeyBack) {
         if(input_event->type == InputTypeShort) {
             if(tama_game->callback)
@@ -123,7 +180,7 @@ static bool tama_input_callback(InputEvent* input_event, void* context) {
         }
     }
 
-    furi_mutex_release(g_state_mutex);
+    furi_mutex_release(g_ctx->state_mutex);
 
     return true;
 }
@@ -131,6 +188,10 @@ static bool tama_input_callback(InputEvent* input_event, void* context) {
 static void tama_game_enter_callback(void* context) {
     UNUSED(context);
 
+    // Redraw right away, even if the LCD was static before the menu opened
+    g_ctx->low_power.static_frames = 0;
+    tama_p1_hal_low_power(TamaLowPowerStatic, false);
+    tama_p1_hal_low_power(TamaLowPowerHidden, false);
     if(g_ctx->timer) furi_timer_start(g_ctx->timer, furi_kernel_get_tick_frequency() / 30);
 }
 
@@ -138,12 +199,21 @@ static void tama_game_exit_callback(void* context) {
     UNUSED(context);
 
     if(g_ctx->timer) furi_timer_stop(g_ctx->timer);
+    tama_p1_hal_low_power(TamaLowPowerHidden, true);
 }
 
 TamaGame* tama_game_alloc() {
     TamaGame* tama_game = malloc(sizeof(TamaGame));
     tama_game->view = view_alloc();
 
+    tama_icon_cache_decode(&tama_game->icon_cache);
+
+    // The draw callback only gets the model, which points back here
+    view_allocate_model(tama_game->view, ViewModelTypeLockFree, sizeof(TamaGame*));
+    TamaGame** model = view_get_model(tama_game->view);
+    *model = tama_game;
+    view_commit_model(tama_game->view, false);
+
     view_set_context(tama_game->view, tama_game);
     view_set_draw_callback(tama_game->view, tama_draw_callback);
     view_set_input_callback(tama_game->view, tama_input_callback);
@@ -1,4 +1,3 @@
-#include <furi_hal.h>
 #include <gui/view.h>
 #include <gui/modules/variable_item_list.h>
 #include "../tama.h"
@@ -6,6 +5,7 @@
 
 typedef struct TamaMenu {
     VariableItemList* list;
+    VariableItem* speed_item;
     TamaMenuCallback callback;
     void* context;
 } TamaMenu;
@@ -13,41 +13,110 @@ typedef struct TamaMenu {
 typedef enum {
     TamaMenuItemSave,
     TamaMenuItemLoad,
+    TamaMenuItemRecord,
+    TamaMenuItemReplay,
+    TamaMenuItemCapture,
     TamaMenuItemSpeed,
     TamaMenuItemMute,
+    TamaMenuItemPet,
     TamaMenuItemReset,
     TamaMenuItemBrowse,
     TamaMenuItemStopNoSave,
 } TamaMenuItem;
 
-static const char* cpu_speed_names[] = {"Off", "2x", "4x"};
+static const char* cpu_speed_names[TamaSpeedNum] = {
+    [TamaSpeedQuarter] = "1/4x",
+    [TamaSpeedHalf] = "1/2x",
+    [TamaSpeed1x] = "1x",
+    [TamaSpeed2x] = "2x",
+    [TamaSpeed4x] = "4x",
+    [TamaSpeed8x] = "8x",
+    [TamaSpeed16x] = "16x",
+    [TamaSpeed32x] = "32x",
+    [TamaSpeed64x] = "64x",
+    [TamaSpeedMax] = "Max",
+};
 static const char* buzzer_mute_names[] = {"Off", "On"};
+static const char* record_names[] = {"Off", "On"};
+static const char* pet_names[] = {"1", "2", "3", "4", "5", "6", "7", "8"};
+
+#if TAMA_DAYCARE_PETS > 8
+#error "Name the extra pets in pet_names"
+#endif
 
 static void tama_cpu_speed_change_callback(VariableItem* item) {
     uint8_t index = variable_item_get_current_value_index(item);
     variable_item_set_current_value_text(item, cpu_speed_names[index]);
 
-    if(furi_mutex_acquire(g_state_mutex, FuriWaitForever) != FuriStatusOk) return;
+    if(furi_mutex_acquire(g_ctx->state_mutex, FuriWaitForever) != FuriStatusOk) return;
+
+    // Without a ROM there is no core, HAL or audio thread to retune yet
+    if(g_ctx->rom != NULL)
+        tama_p1_hal_set_speed(index);
+    else
+        g_ctx->cpu_speed = index;
+    furi_mutex_release(g_ctx->state_mutex);
+}
+
+static void tama_record_change_callback(VariableItem* item) {
+    TamaMenu* tama_menu = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+
+    if(tama_menu->callback)
+        tama_menu->callback(
+            index == 1 ? TamaMenuEventTypeRecordStart : TamaMenuEventTypeRecordStop,
+            tama_menu->context);
+
+    // Refused during a replay or without a movie file, show what actually runs
+    if(furi_mutex_acquire(g_ctx->state_mutex, FuriWaitForever) != FuriStatusOk) return;
+    index = g_ctx->movie.mode == TamaMovieModeRecord ? 1 : 0;
+    furi_mutex_release(g_ctx->state_mutex);
+
+    variable_item_set_current_value_index(item, index);
+    variable_item_set_current_value_text(item, record_names[index]);
+}
+
+static void tama_capture_change_callback(VariableItem* item) {
+    TamaMenu* tama_menu = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+
+    if(tama_menu->callback)
+        tama_menu->callback(
+            index == 1 ? TamaMenuEventTypeCaptureStart : TamaMenuEventTypeCaptureStop,
+            tama_menu->context);
 
-    g_ctx->cpu_speed = index;
-    tamalib_set_speed(1 << index);
-    furi_mutex_release(g_state_mutex);
+    // Nothing starts without a ROM or when the file cannot be created
+    if(furi_mutex_acquire(g_ctx->draw_mutex, FuriWaitForever) != FuriStatusOk) return;
+    index = g_ctx->capture.active ? 1 : 0;
+    furi_mutex_release(g_ctx->draw_mutex);
+
+    variable_item_set_current_value_index(item, index);
+    variable_item_set_current_value_text(item, record_names[index]);
 }
 
 static void tama_buzzer_mute_change_callback(VariableItem* item) {
     uint8_t index = variable_item_get_current_value_index(item);
     variable_item_set_current_value_text(item, buzzer_mute_names[index]);
 
-    if(furi_mutex_acquire(g_state_mutex, FuriWaitForever) != FuriStatusOk) return;
+    if(furi_mutex_acquire(g_ctx->state_mutex, FuriWaitForever) != FuriStatusOk) return;
 
     g_ctx->buzzer_mute = index == 1;
+    if(g_ctx->rom != NULL) tama_p1_hal_buzzer_sync();
 
-    if(g_ctx->buzzer_mute && furi_hal_speaker_is_mine()) {
-        furi_hal_speaker_stop();
-        furi_hal_speaker_release();
-    }
+    furi_mutex_release(g_ctx->state_mutex);
+}
+
+static void tama_pet_change_callback(VariableItem* item) {
+    uint8_t index = variable_item_get_current_value_index(item);
+
+    if(furi_mutex_acquire(g_ctx->state_mutex, FuriWaitForever) != FuriStatusOk) return;
 
-    furi_mutex_release(g_state_mutex);
+    // Refused while a movie runs, stay with the shown pet then
+    if(!tama_p1_daycare_show(index)) index = g_ctx->daycare.shown;
+    furi_mutex_release(g_ctx->state_mutex);
+
+    variable_item_set_current_value_index(item, index);
+    variable_item_set_current_value_text(item, pet_names[index]);
 }
 
 static void tama_menu_callback(void* context, uint32_t index) {
@@ -64,6 +133,10 @@ static void tama_menu_callback(void* context, uint32_t index) {
         if(tama_menu->callback) tama_menu->callback(TamaMenuEventTypeLoad, tama_menu->context);
         break;
 
+    case TamaMenuItemReplay:
+        if(tama_menu->callback) tama_menu->callback(TamaMenuEventTypeReplay, tama_menu->context);
+        break;
+
     case TamaMenuItemReset:
         if(tama_menu->callback) tama_menu->callback(TamaMenuEventTypeReset, tama_menu->context);
         break;
@@ -91,15 +164,31 @@ TamaMenu* tama_menu_alloc() {
     variable_item_list_add(tama_menu->list, "Load State", 0, NULL, NULL);
 
     item = variable_item_list_add(
-        tama_menu->list, "CPU Speed", 3, tama_cpu_speed_change_callback, NULL);
-    variable_item_set_current_value_index(item, g_ctx->cpu_speed);
-    variable_item_set_current_value_text(item, cpu_speed_names[g_ctx->cpu_speed]);
+        tama_menu->list, "Record Movie", 2, tama_record_change_callback, tama_menu);
+    variable_item_set_current_value_index(item, 0);
+    variable_item_set_current_value_text(item, record_names[0]);
+
+    variable_item_list_add(tama_menu->list, "Replay Movie", 0, NULL, NULL);
+
+    item = variable_item_list_add(
+        tama_menu->list, "Record Screen", 2, tama_capture_change_callback, tama_menu);
+    variable_item_set_current_value_index(item, 0);
+    variable_item_set_current_value_text(item, record_names[0]);
+
+    tama_menu->speed_item = variable_item_list_add(
+        tama_menu->list, "CPU Speed", TamaSpeedNum, tama_cpu_speed_change_callback, NULL);
+    tama_menu_refresh(tama_menu);
 
     item = variable_item_list_add(
         tama_menu->list, "Buzzer Mute", 2, tama_buzzer_mute_change_callback, NULL);
     variable_item_set_current_value_index(item, g_ctx->buzzer_mute ? 1 : 0);
     variable_item_set_current_value_text(item, buzzer_mute_names[g_ctx->buzzer_mute ? 1 : 0]);
 
+    item = variable_item_list_add(
+        tama_menu->list, "Pet", TAMA_DAYCARE_PETS, tama_pet_change_callback, NULL);
+    variable_item_set_current_value_index(item, g_ctx->daycare.shown);
+    variable_item_set_current_value_text(item, pet_names[g_ctx->daycare.shown]);
+
     variable_item_list_add(tama_menu->list, "Reset ROM", 0, NULL, NULL);
     variable_item_list_add(tama_menu->list, "Browse ROM", 0, NULL, NULL);
     variable_item_list_add(tama_menu->list, "Exit Without Save", 0, NULL, NULL);
@@ -120,6 +209,18 @@ View* tama_menu_get_view(TamaMenu* tama_menu) {
     return variable_item_list_get_view(tama_menu->list);
 }
 
+void tama_menu_refresh(TamaMenu* tama_menu) {
+    furi_assert(tama_menu);
+
+    // A movie replay runs at Max and restores the speed when it ends
+    if(furi_mutex_acquire(g_ctx->state_mutex, FuriWaitForever) != FuriStatusOk) return;
+    uint8_t speed = g_ctx->cpu_speed;
+    furi_mutex_release(g_ctx->state_mutex);
+
+    variable_item_set_current_value_index(tama_menu->speed_item, speed);
+    variable_item_set_current_value_text(tama_menu->speed_item, cpu_speed_names[speed]);
+}
+
 void tama_menu_set_callback(TamaMenu* tama_menu, TamaMenuCallback callback, void* context) {
     furi_assert(tama_menu);
     tama_menu->callback = callback;
@@ -5,6 +5,11 @@
 typedef enum {
     TamaMenuEventTypeSave,
     TamaMenuEventTypeLoad,
+    TamaMenuEventTypeRecordStart,
+    TamaMenuEventTypeRecordStop,
+    TamaMenuEventTypeReplay,
+    TamaMenuEventTypeCaptureStart,
+    TamaMenuEventTypeCaptureStop,
     TamaMenuEventTypeReset,
     TamaMenuEventTypeBrowse,
     TamaMenuEventTypeStopNoSave,
@@ -17,4 +22,6 @@ typedef void (*TamaMenuCallback)(TamaMenuEventType event_type, void* context);
 TamaMenu* tama_menu_alloc();
 void tama_menu_free(TamaMenu* tama_menu);
 View* tama_menu_get_view(TamaMenu* tama_menu);
+// Updates the items the app changes on its own, before the menu is shown
+void tama_menu_refresh(TamaMenu* tama_menu);
 void tama_menu_set_callback(TamaMenu* tama_menu, TamaMenuCallback callback, void* context);